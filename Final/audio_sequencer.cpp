@@ -0,0 +1,184 @@
+#include "audio_sequencer.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+static AudioSequencer *sequencerOwner = nullptr;
+
+ISR(TIMER2_COMPA_vect) {
+  sequencerOwner->tick();
+}
+#endif
+
+AudioSequencer::AudioSequencer(uint8_t buzzerPin)
+  : pin(buzzerPin), running(false), sounding(0), stepMicros(0), polledAt(0) {
+  memset(channels, 0, sizeof(channels));
+}
+
+void AudioSequencer::begin() {
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+#if defined(__AVR__)
+  sequencerOwner = this;
+  // The core left Timer2 running phase correct PWM for analogWrite()
+  TIMSK2 = 0;
+  TCCR2B = 0;
+  TCCR2A = 0;
+#endif
+}
+
+// Keeps the ISR off the channels and Timer2. The barriers keep the channel
+// updates between the two.
+void AudioSequencer::pause() {
+#if defined(__AVR__)
+  TIMSK2 &= ~_BV(OCIE2A);
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+void AudioSequencer::resume() {
+#if defined(__AVR__)
+  __asm__ __volatile__("" ::: "memory");
+  if (running) TIMSK2 |= _BV(OCIE2A);
+#endif
+}
+
+void AudioSequencer::load(Channel &ch) {
+  ch.frequency = pgm_read_word(&ch.notes[ch.index].frequency);
+  ch.remaining += (int32_t)pgm_read_word(&ch.notes[ch.index].duration) * 1000;
+}
+
+void AudioSequencer::play(uint8_t channel, const ToneSequence *notes, uint8_t count, bool repeat) {
+  poll(); // Other channels keep their time on the host too
+  pause();
+  Channel &ch = channels[channel];
+  ch.notes = notes;
+  ch.count = count;
+  ch.index = 0;
+  ch.repeat = repeat;
+  ch.remaining = 0;
+  if (count) load(ch);
+  update();
+  resume();
+}
+
+void AudioSequencer::stop(uint8_t channel) {
+  poll();
+  pause();
+  channels[channel].count = 0;
+  update();
+  resume();
+}
+
+void AudioSequencer::stopAll() {
+  pause();
+  for (uint8_t c = 0; c < AUDIO_CHANNELS; c++) channels[c].count = 0;
+  update();
+  resume();
+}
+
+// An overshoot carries into the next note, so a track keeps its tempo
+// whatever the step it is counted in
+void AudioSequencer::advance(uint32_t elapsed) {
+  for (uint8_t c = 0; c < AUDIO_CHANNELS; c++) {
+    Channel &ch = channels[c];
+    if (!ch.count) continue;
+    ch.remaining -= elapsed;
+    while (ch.remaining <= 0) {
+      if (++ch.index >= ch.count) {
+        if (!ch.repeat) {
+          ch.count = 0;
+          break;
+        }
+        ch.index = 0;
+      }
+      load(ch);
+    }
+  }
+}
+
+void AudioSequencer::update() {
+  for (uint8_t c = AUDIO_CHANNELS; c-- > 0;) {
+    if (!channels[c].count) continue;
+    if (!running || channels[c].frequency != sounding) output(channels[c].frequency);
+    return;
+  }
+  if (running) silence();
+}
+
+void AudioSequencer::tick() {
+  advance(stepMicros);
+  update();
+}
+
+void AudioSequencer::output(uint16_t frequency) {
+  running = true;
+  sounding = frequency;
+#if defined(__AVR__)
+  TCNT2 = 0;
+  if (!frequency) {
+    // A rest: OC2B off (the pin stays low) and a 1 ms step at /64
+    TCCR2A = _BV(WGM21);
+    OCR2A = 249;
+    TCCR2B = _BV(CS22);
+    stepMicros = 1000;
+    return;
+  }
+  // The smallest prescaler from /32 up (a step is then a whole number of
+  // microseconds) that fits half a period in 8 bits. Their CS2 values are
+  // 3 to 7 in this order.
+  static const uint8_t prescaleShifts[] = { 5, 6, 7, 8, 10 };
+  uint8_t s = 0;
+  uint32_t counts = 0;
+  for (; s < sizeof(prescaleShifts); s++) {
+    counts = ((F_CPU / 2) >> prescaleShifts[s]) / frequency;
+    if (counts <= 256) break;
+  }
+  if (s == sizeof(prescaleShifts)) {
+    s--;
+    counts = 256;
+  }
+  if (counts == 0) counts = 1;
+  // OCR2A is not double-buffered in CTC mode, so the new period starts at
+  // once. OC2B toggles on its match with the same count.
+  OCR2A = counts - 1;
+  OCR2B = counts - 1;
+  TCCR2A = _BV(COM2B0) | _BV(WGM21);
+  TCCR2B = s + 3;
+  stepMicros = (counts << prescaleShifts[s]) / (F_CPU / 1000000);
+#else
+  if (frequency) tone(pin, frequency);
+  else noTone(pin);
+#endif
+}
+
+void AudioSequencer::silence() {
+  running = false;
+  sounding = 0;
+#if defined(__AVR__)
+  TIMSK2 &= ~_BV(OCIE2A);
+  TCCR2B = 0;
+  TCCR2A = 0;
+#else
+  noTone(pin);
+#endif
+}
+
+uint16_t AudioSequencer::poll() {
+#if defined(__AVR__)
+  return 0;
+#else
+  uint32_t now = millis();
+  uint32_t elapsed = now - polledAt;
+  polledAt = now;
+  if (!running) return 0;
+  advance(elapsed * 1000);
+  update();
+
+  int32_t next = INT32_MAX;
+  for (uint8_t c = 0; c < AUDIO_CHANNELS; c++) {
+    if (channels[c].count && channels[c].remaining < next) next = channels[c].remaining;
+  }
+  return next == INT32_MAX ? 0 : (next + 999) / 1000;
+#endif
+}
@@ -0,0 +1,77 @@
+#ifndef AUDIO_SEQUENCER_H
+#define AUDIO_SEQUENCER_H
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+// One note of a track in PROGMEM; a frequency of 0 is a rest
+struct ToneSequence {
+  uint16_t frequency; // Hz
+  uint16_t duration;  // ms, never 0
+};
+
+// Lowest priority first
+enum AudioChannel {
+  AUDIO_MUSIC,
+  AUDIO_SFX,
+  AUDIO_CHANNELS
+};
+
+// Plays PROGMEM tracks on a buzzer, one per channel. The buzzer sounds the
+// highest-priority channel that has a track; the ones below it keep time
+// silently, so the music picks up in beat once an effect is over.
+//
+// On the AVR, Timer2 does all of it. In CTC mode it toggles OC2B (pin 3,
+// the only pin it can be) at the note's frequency, and its compare
+// interrupt counts the notes down and loads the next ones, so nothing
+// depends on how often loop() comes round. The timer is stopped whenever
+// every channel is done. It takes Timer2 from tone() and from analogWrite()
+// on pins 3 and 11.
+//
+// Elsewhere poll() advances the tracks to millis() and plays them with
+// tone() instead.
+class AudioSequencer {
+public:
+  AudioSequencer(uint8_t pin);
+
+  void begin();
+  // Replaces what the channel was playing
+  void play(uint8_t channel, const ToneSequence *notes, uint8_t count, bool repeat = false);
+  void stop(uint8_t channel);
+  void stopAll();
+  bool playing(uint8_t channel) const { return channels[channel].count != 0; }
+
+  // Milliseconds until the next note change, 0 if nothing is playing.
+  // Does nothing on the AVR.
+  uint16_t poll();
+
+  // ISR half: one compare match has gone by
+  void tick();
+
+private:
+  struct Channel {
+    const ToneSequence *notes;
+    uint8_t count; // 0 when idle
+    uint8_t index;
+    bool repeat;
+    uint16_t frequency; // Of the current note
+    int32_t remaining;  // us left of the current note
+  };
+
+  void pause();
+  void resume();
+  void load(Channel &ch);
+  void advance(uint32_t elapsed);
+  void update();
+  void output(uint16_t frequency);
+  void silence();
+
+  uint8_t pin;
+  Channel channels[AUDIO_CHANNELS];
+  bool running;
+  uint16_t sounding;   // Frequency on the pin while running, 0 for a rest
+  uint16_t stepMicros; // Time between two compare matches
+  uint32_t polledAt;
+};
+
+#endif
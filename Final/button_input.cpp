@@ -0,0 +1,76 @@
+#include "button_input.h"
+
+static ButtonInput *buttonOwner = nullptr;
+
+static void buttonEdgeIsr() {
+  buttonOwner->recordEdge();
+}
+
+ButtonInput::ButtonInput(uint8_t pin, uint16_t debounceMs, uint16_t longPressMs)
+  : pin(pin), debounceMs(debounceMs), longPressMs(longPressMs), head(0), dropped(0), tail(0),
+    rawDown(false), stableDown(false), locked(false), lockUntil(0), pressTime(0), longSent(true) {
+}
+
+void ButtonInput::begin() {
+  buttonOwner = this;
+  pinMode(pin, INPUT_PULLUP);
+  rawDown = stableDown = (digitalRead(pin) == LOW);
+  // Held since power-up: don't report a long press for it
+  longSent = true;
+  attachInterrupt(digitalPinToInterrupt(pin), buttonEdgeIsr, CHANGE);
+}
+
+void ButtonInput::recordEdge() {
+  uint8_t level = (digitalRead(pin) == LOW) ? 1 : 0;
+  uint16_t now = (uint16_t)millis();
+  uint8_t next = (head + 1) & (ringSize - 1);
+  if (next == tail) {
+    // Full: overwrite the newest entry so the final level is never lost;
+    // the consumer only ever reads at `tail`, which is not that slot
+    uint8_t last = (head - 1) & (ringSize - 1);
+    edgeTimes[last] = now;
+    edgeLevels[last] = level;
+    dropped++;
+    return;
+  }
+  edgeTimes[head] = now;
+  edgeLevels[head] = level;
+  head = next;
+}
+
+ButtonEvent ButtonInput::accept(bool down, uint16_t at) {
+  stableDown = down;
+  locked = true;
+  lockUntil = at + debounceMs;
+  if (!down) return BUTTON_RELEASE;
+  pressTime = at;
+  longSent = false;
+  return BUTTON_PRESS;
+}
+
+ButtonEvent ButtonInput::next(uint16_t now) {
+  while (true) {
+    if (locked) {
+      // The window ends at lockUntil: re-sync to the level the bounce
+      // settled on before looking at any later edge
+      uint16_t t = (tail != head) ? edgeTimes[tail] : now;
+      if ((int16_t)(t - lockUntil) >= 0) {
+        locked = false;
+        if (rawDown != stableDown) return accept(rawDown, lockUntil);
+      }
+    }
+    if (tail == head) break;
+
+    uint8_t i = tail;
+    uint16_t t = edgeTimes[i];
+    rawDown = edgeLevels[i] != 0;
+    tail = (i + 1) & (ringSize - 1);
+    if (!locked && rawDown != stableDown) return accept(rawDown, t);
+  }
+
+  if (stableDown && !longSent && (int16_t)(now - pressTime) >= (int16_t)longPressMs) {
+    longSent = true;
+    return BUTTON_LONG_PRESS;
+  }
+  return BUTTON_NONE;
+}
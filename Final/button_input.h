@@ -0,0 +1,60 @@
+#ifndef BUTTON_INPUT_H
+#define BUTTON_INPUT_H
+
+#include <Arduino.h>
+
+enum ButtonEvent : uint8_t {
+  BUTTON_NONE,
+  BUTTON_PRESS,
+  BUTTON_RELEASE,
+  BUTTON_LONG_PRESS // once per press, longPressMs after it went down
+};
+
+// Active-low push button on an external-interrupt pin. The ISR only stores
+// (millis, level) for every edge in a single-producer/single-consumer ring;
+// next() debounces them in the main context, at whatever pace loop() runs.
+// A press is taken at its first edge and the following debounceMs of bounce
+// are ignored, then the button is re-synced to the last level seen, so even
+// a tap shorter than one loop() pass produces a press and a release.
+class ButtonInput {
+public:
+  ButtonInput(uint8_t pin, uint16_t debounceMs, uint16_t longPressMs);
+
+  // Enables the pull-up and attaches the CHANGE interrupt
+  void begin();
+
+  // Next debounced event at time `now` (low 16 bits of millis()), or
+  // BUTTON_NONE when there is nothing new
+  ButtonEvent next(uint16_t now);
+  bool isDown() const { return stableDown; }
+  uint16_t droppedEdges() const { return dropped; }
+
+  // ISR half
+  void recordEdge();
+
+  static const uint8_t ringSize = 16; // power of two
+
+private:
+  ButtonEvent accept(bool down, uint16_t at);
+
+  uint8_t pin;
+  uint16_t debounceMs;
+  uint16_t longPressMs;
+
+  // Written by the ISR only
+  volatile uint16_t edgeTimes[ringSize];
+  volatile uint8_t edgeLevels[ringSize]; // 1 = pressed
+  volatile uint8_t head;
+  volatile uint16_t dropped;
+  // Written by the main context only
+  volatile uint8_t tail;
+
+  bool rawDown;    // level after the last edge consumed
+  bool stableDown;
+  bool locked;     // inside the debounce window after an accepted edge
+  uint16_t lockUntil;
+  uint16_t pressTime;
+  bool longSent;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "eeprom_journal.h"
+
+uint16_t crc16Update(uint16_t crc, uint8_t data) {
+  crc ^= (uint16_t)data << 8;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+EepromJournal::EepromJournal(EepromQueue &store, uint16_t start, uint8_t slotSize, uint8_t slotCount,
+                             uint8_t recordType)
+  : eeprom(store), base(start), slotBytes(slotSize), slots(slotCount), type(recordType), newest(slotCount), seq(0) {
+}
+
+bool EepromJournal::slotValid(uint8_t slot) {
+  uint16_t addr = slotAddress(slot);
+  uint16_t crc = 0xFFFF;
+  uint8_t covered = slotBytes - crcSize;
+  for (uint8_t i = 0; i < covered; i++) crc = crc16Update(crc, eeprom.read(addr + i));
+  uint16_t stored = eeprom.read(addr + covered) | ((uint16_t)eeprom.read(addr + covered + 1) << 8);
+  return crc == stored;
+}
+
+uint8_t EepromJournal::load(void *payload, uint8_t length) {
+  if (length > payloadCapacity()) return 0;
+  newest = slots;
+  uint8_t version = 0;
+  for (uint8_t slot = 0; slot < slots; slot++) {
+    uint16_t addr = slotAddress(slot);
+    if (eeprom.read(addr) != type) continue;
+    uint16_t s = eeprom.read(addr + 2) | ((uint16_t)eeprom.read(addr + 3) << 8);
+    // Wrap-safe: a ring of at most 255 slots never spans half the counter
+    if (newest != slots && (int16_t)(s - seq) <= 0) continue;
+    if (!slotValid(slot)) continue;
+    newest = slot;
+    seq = s;
+    version = eeprom.read(addr + 1);
+  }
+  if (newest == slots) return 0;
+
+  uint16_t addr = slotAddress(newest) + headerSize;
+  uint8_t *out = (uint8_t *)payload;
+  for (uint8_t i = 0; i < length; i++) out[i] = eeprom.read(addr + i);
+  return version;
+}
+
+void EepromJournal::commit(const void *payload, uint8_t length, uint8_t version) {
+  if (length > payloadCapacity()) return;
+  uint8_t slot = (newest == slots) ? 0 : (newest + 1) % slots;
+  uint16_t next = (newest == slots) ? 0 : seq + 1;
+  uint16_t addr = slotAddress(slot);
+
+  uint8_t header[headerSize] = { type, version, (uint8_t)next, (uint8_t)(next >> 8) };
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < headerSize; i++) {
+    eeprom.update(addr + i, header[i]);
+    crc = crc16Update(crc, header[i]);
+  }
+  // Unused payload bytes are zeroed so the CRC covers a fixed-size slot
+  // whatever the payload length of the format version
+  const uint8_t *in = (const uint8_t *)payload;
+  for (uint8_t i = 0; i < payloadCapacity(); i++) {
+    uint8_t b = i < length ? in[i] : 0;
+    eeprom.update(addr + headerSize + i, b);
+    crc = crc16Update(crc, b);
+  }
+  uint16_t crcAddr = addr + slotBytes - crcSize;
+  eeprom.update(crcAddr, (uint8_t)crc);
+  eeprom.update(crcAddr + 1, (uint8_t)(crc >> 8));
+
+  newest = slot;
+  seq = next;
+}
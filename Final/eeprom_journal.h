@@ -0,0 +1,53 @@
+#ifndef EEPROM_JOURNAL_H
+#define EEPROM_JOURNAL_H
+
+#include <Arduino.h>
+#include "eeprom_queue.h"
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bitwise so it costs no table
+uint16_t crc16Update(uint16_t crc, uint8_t data);
+
+// A region of the EEPROM holding one logical record as a ring of slots.
+// Each commit writes a whole new copy into the slot after the newest one,
+// so writes spread evenly over the region and a commit torn by a reset
+// leaves the previous copy intact.
+//
+// Slot layout: type, payload format version, 16-bit sequence number (LE),
+// payload zero-padded to the slot size, CRC-16 over everything before it. Erased slots (0xFF) and slots
+// of another type are rejected on the first byte.
+//
+// All access goes through an EepromQueue, so commit() only queues bytes.
+class EepromJournal {
+public:
+  static const uint8_t headerSize = 4;
+  static const uint8_t crcSize = 2;
+
+  EepromJournal(EepromQueue &store, uint16_t start, uint8_t slotSize, uint8_t slotCount,
+                uint8_t recordType);
+
+  // Finds the newest valid record in one pass over the slots and copies up
+  // to `length` payload bytes out. Returns its format version, 0 if there
+  // is none.
+  uint8_t load(void *payload, uint8_t length);
+
+  // Writes `length` payload bytes as the next record (call load() first)
+  void commit(const void *payload, uint8_t length, uint8_t version);
+
+  uint16_t sequence() const { return seq; }
+  uint8_t payloadCapacity() const { return slotBytes - headerSize - crcSize; }
+  uint16_t end() const { return base + (uint16_t)slotBytes * slots; }
+
+private:
+  uint16_t slotAddress(uint8_t slot) const { return base + (uint16_t)slot * slotBytes; }
+  bool slotValid(uint8_t slot);
+
+  EepromQueue &eeprom;
+  uint16_t base;
+  uint8_t slotBytes;
+  uint8_t slots;
+  uint8_t type;
+  uint8_t newest;   // slot of the newest valid record, slots when empty
+  uint16_t seq;
+};
+
+#endif
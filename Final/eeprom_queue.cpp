@@ -0,0 +1,125 @@
+#include "eeprom_queue.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+static EepromQueue *queueOwner = nullptr;
+
+ISR(EE_READY_vect) {
+  queueOwner->writeNext();
+}
+#endif
+
+EepromQueue::EepromQueue() : tail(0), head(0), count(0) {
+#if defined(__AVR__)
+  queueOwner = this;
+#endif
+  resetStats();
+}
+
+// Keeps the ISR off the queue and the EEPROM address/data registers. A
+// write already started keeps going; EEPROM.read() waits for it.
+void EepromQueue::pause() {
+#if defined(__AVR__)
+  EECR &= ~_BV(EERIE);
+#endif
+}
+
+void EepromQueue::resume() {
+#if defined(__AVR__)
+  if (count) EECR |= _BV(EERIE);
+#endif
+}
+
+void EepromQueue::writeNext() {
+  if (count == 0) {
+#if defined(__AVR__)
+    EECR &= ~_BV(EERIE);
+#endif
+    return;
+  }
+  uint16_t addr = addrs[tail];
+  uint8_t value = values[tail];
+  tail = (tail + 1) % capacity;
+  count--;
+#if defined(__AVR__)
+  // Erase + write; EEPE must follow EEMPE within four cycles
+  EEAR = addr;
+  EEDR = value;
+  EECR |= _BV(EEMPE);
+  EECR |= _BV(EEPE);
+#else
+  EEPROM.write(addr, value);
+#endif
+}
+
+int8_t EepromQueue::findPending(uint16_t addr) const {
+  // Newest first, though an address is only ever queued once
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t slot = (head + capacity - 1 - i) % capacity;
+    if (addrs[slot] == addr) return slot;
+  }
+  return -1;
+}
+
+uint8_t EepromQueue::read(uint16_t addr) {
+  pause();
+  int8_t slot = findPending(addr);
+  uint8_t value = slot >= 0 ? values[slot] : EEPROM.read(addr);
+  resume();
+  return value;
+}
+
+void EepromQueue::read(uint16_t addr, void *out, uint8_t length) {
+  uint8_t *bytes = (uint8_t *)out;
+  for (uint8_t i = 0; i < length; i++) bytes[i] = read(addr + i);
+}
+
+void EepromQueue::update(uint16_t addr, uint8_t value) {
+  while (true) {
+    pause();
+    int8_t slot = findPending(addr);
+    if (slot >= 0) {
+      values[slot] = value;
+      counters.bytesCoalesced++;
+      break;
+    }
+    if (EEPROM.read(addr) == value) {
+      counters.bytesUnchanged++;
+      break;
+    }
+    if (count < capacity) {
+      addrs[head] = addr;
+      values[head] = value;
+      head = (head + 1) % capacity;
+      count++;
+      counters.bytesQueued++;
+      if (count > counters.maxDepth) counters.maxDepth = count;
+      break;
+    }
+    // Full: let the writer make room
+    resume();
+    counters.fullStalls++;
+    uint8_t before = count;
+    while (count == before) poll();
+  }
+  resume();
+}
+
+void EepromQueue::poll() {
+#if !defined(__AVR__)
+  writeNext();
+#endif
+}
+
+void EepromQueue::flush() {
+  while (count) poll();
+#if defined(__AVR__)
+  // The last byte's write may still be running
+  while (EECR & _BV(EEPE));
+#endif
+}
+
+void EepromQueue::resetStats() {
+  memset(&counters, 0, sizeof(counters));
+}
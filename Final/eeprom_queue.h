@@ -0,0 +1,57 @@
+#ifndef EEPROM_QUEUE_H
+#define EEPROM_QUEUE_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+struct EepromQueueStats {
+  uint32_t bytesQueued;
+  uint32_t bytesUnchanged; // update() calls that matched what is stored
+  uint32_t bytesCoalesced; // rewrote a byte that was still queued
+  uint16_t fullStalls;     // update() had to wait for room
+  uint8_t maxDepth;
+};
+
+// Background EEPROM writer. update() queues (address, byte) pairs and
+// returns at once; on the AVR the EE_READY interrupt writes one byte each
+// time the previous ~3.3 ms write finishes. read() sees queued bytes before
+// they reach the cells, and flush() waits until everything is written for
+// the few cases that must be on the chip before going on.
+//
+// Elsewhere poll() writes one queued byte per call instead.
+//
+// While this is active, all EEPROM access must go through it: the AVR
+// EEPROM registers are shared with the interrupt.
+class EepromQueue {
+public:
+  static const uint8_t capacity = 32; // one journal slot or leaderboard insert
+
+  EepromQueue();
+
+  uint8_t read(uint16_t addr);
+  void read(uint16_t addr, void *out, uint8_t length);
+  void update(uint16_t addr, uint8_t value);
+  void flush();
+  void poll();
+
+  uint8_t pending() const { return count; }
+  const EepromQueueStats &stats() const { return counters; }
+  void resetStats();
+
+  // ISR half: start the next write, EEPROM idle
+  void writeNext();
+
+private:
+  void pause();
+  void resume();
+  int8_t findPending(uint16_t addr) const;
+
+  uint16_t addrs[capacity];
+  uint8_t values[capacity];
+  volatile uint8_t tail; // next to write, advanced by the ISR
+  uint8_t head;          // next free, advanced by update()
+  volatile uint8_t count;
+  EepromQueueStats counters;
+};
+
+#endif
@@ -0,0 +1,213 @@
+// Drives the firmware loop() through a scripted session on the
+// host and reports per-iteration cost and peripheral traffic per game state.
+//
+// Usage: loop_bench [--game-seconds N] [--seed N] [--imu]
+//
+// --imu turns on IMU control; the random walk then also tilts the board.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "hal_host.h"
+#include "main.cpp"
+
+static const char *stateNames[] = {
+  "INTRO", "MENU_MAIN", "MENU_HIGHSCORES", "MENU_SETTINGS", "SETTINGS_LCD",
+  "SETTINGS_MATRIX", "SETTINGS_SOUND", "SETTINGS_IMU", "SETTINGS_MAZE", "SETTINGS_RESET",
+  "SETTINGS_BACK", "MENU_ABOUT", "MENU_HOWTO", "GAME_PLAYING", "GAME_PAUSED",
+  "LEVEL_TRANSITION", "GAME_VICTORY", "NAME_ENTRY"
+};
+static const uint8_t stateCount = sizeof(stateNames) / sizeof(stateNames[0]);
+
+// Must match TaskId
+static const char *taskNames[TASK_COUNT] = { "game", "audio", "blinkStar", "blinkPlayer", "render", "lcd", "imu", "saveSettings", "saveScores", "eeprom", "record" };
+
+struct StateStats {
+  uint32_t iterations = 0;
+  uint64_t deviceMicros = 0;
+  uint32_t maxDeviceMicros = 0;
+  std::vector<uint32_t> hostNanos;
+  HostCallCounters calls = {};
+};
+
+static void addCounters(HostCallCounters &total, const HostCallCounters &delta) {
+  uint32_t *dst = reinterpret_cast<uint32_t *>(&total);
+  const uint32_t *src = reinterpret_cast<const uint32_t *>(&delta);
+  for (size_t i = 0; i < sizeof(HostCallCounters) / sizeof(uint32_t); i++) dst[i] += src[i];
+}
+
+// Small LCG so the joystick walk is reproducible independently of the game RNG
+static uint32_t scriptRng = 1;
+static uint32_t nextScriptRandom() {
+  scriptRng = scriptRng * 1664525u + 1013904223u;
+  return scriptRng >> 16;
+}
+
+static void setJoystick(uint16_t x, uint16_t y) {
+  hostSetAnalog(PIN_JOY_X, x);
+  hostSetAnalog(PIN_JOY_Y, y);
+}
+
+static void setButton(bool pressed) {
+  hostSetDigital(PIN_JOY_BTN, pressed ? LOW : HIGH);
+}
+
+// Joystick position as the matching tilt, in m/s^2 (see moveDelta)
+static void setTiltFor(uint16_t x, uint16_t y) {
+  float ax = x < 400 ? 5.0f : x > 600 ? -5.0f : 0.0f;
+  float ay = y < 400 ? -5.0f : y > 600 ? 5.0f : 0.0f;
+  hostSetAcceleration(ax, ay, 9.81f);
+}
+
+static bool inWindow(uint32_t now, uint32_t start, uint32_t length) {
+  return now >= start && now < start + length;
+}
+
+// Intro -> main menu -> play for gameMs -> pause -> exit -> browse the menu
+static uint32_t applyScript(uint32_t now, uint32_t gameMs) {
+  const uint32_t gameStart = 2000;
+  const uint32_t gameEnd = gameStart + gameMs;
+  const uint32_t sessionEnd = gameEnd + 4000;
+
+  bool pressed = inWindow(now, 1000, 150) || inWindow(now, 1600, 150) ||
+                 inWindow(now, gameEnd, 150) || inWindow(now, gameEnd + 800, 150);
+  setButton(pressed);
+
+  static uint32_t lastStepStart = 0;
+  static uint16_t stepX = 512, stepY = 512;
+  if (now >= gameStart && now < gameEnd) {
+    // Random walk: hold a direction for 250 ms, release for 50 ms
+    if (now - lastStepStart >= 300) {
+      lastStepStart = now;
+      stepX = 512;
+      stepY = 512;
+      switch (nextScriptRandom() % 4) {
+        case 0: stepY = 100; break;
+        case 1: stepY = 900; break;
+        case 2: stepX = 100; break;
+        default: stepX = 900; break;
+      }
+    }
+    if (now - lastStepStart < 250) {
+      setJoystick(stepX, stepY);
+      setTiltFor(stepX, stepY);
+    } else {
+      setJoystick(512, 512);
+      setTiltFor(512, 512);
+    }
+  } else if (inWindow(now, gameEnd + 400, 100)) {
+    setJoystick(900, 512); // pause menu: select Exit
+  } else if (now >= gameEnd + 1500 && now < sessionEnd && (now - gameEnd) % 400 < 100) {
+    setJoystick(512, 100); // cycle through the main menu
+  } else {
+    setJoystick(512, 512);
+  }
+  return sessionEnd;
+}
+
+int main(int argc, char **argv) {
+  uint32_t gameSeconds = 60;
+  bool useImu = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--game-seconds") && i + 1 < argc) gameSeconds = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc) scriptRng = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--imu")) useImu = true;
+    else {
+      fprintf(stderr, "usage: %s [--game-seconds N] [--seed N] [--imu]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<StateStats> stats(stateCount);
+  setButton(false);
+  setJoystick(512, 512);
+  hostAttachMax7219(PIN_MATRIX_DIN, PIN_MATRIX_CLK, PIN_MATRIX_LOAD, matrixModules);
+  setup();
+  settingIMUEnabled = useImu;
+
+  uint64_t sessionStart = hostMicros();
+  uint64_t totalIterations = 0;
+  uint16_t playingTickRate = 0, playingFrameRate = 0; // Last measured while a game was on
+  uint32_t sessionEnd = applyScript(0, gameSeconds * 1000);
+  while (hostMicros() / 1000 < sessionEnd) {
+    applyScript(hostMicros() / 1000, gameSeconds * 1000);
+
+    uint8_t state = (uint8_t)currentState;
+    hostResetCounters();
+    uint64_t before = hostMicros();
+    auto t0 = std::chrono::steady_clock::now();
+    loop();
+    auto t1 = std::chrono::steady_clock::now();
+    hostAdvanceMicros(hostCost.loopOverhead);
+
+    StateStats &s = stats[state < stateCount ? state : 0];
+    s.iterations++;
+    uint32_t spent = hostMicros() - before;
+    s.deviceMicros += spent;
+    if (spent > s.maxDeviceMicros) s.maxDeviceMicros = spent;
+    s.hostNanos.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    addCounters(s.calls, hostCounters);
+    totalIterations++;
+    if (state == STATE_GAME_PLAYING) {
+      playingTickRate = gameTickRate.perSecond;
+      playingFrameRate = renderFrameRate.perSecond;
+    }
+  }
+
+  double sessionSeconds = (hostMicros() - sessionStart) / 1e6;
+  printf("Simulated %.1f s of device time, %llu loop() iterations (%.0f loops/s on device)\n",
+         sessionSeconds, (unsigned long long)totalIterations, totalIterations / sessionSeconds);
+  printf("Final score %u, level %u, stars %u/%u\n", currentScore, currentLevelIndex + 1,
+         currentLevelStarsCollected, currentLevelStarsTotal);
+  printf("While playing: %u game ticks/s, %u viewport frames/s (capped at %u Hz)\n\n", playingTickRate,
+         playingFrameRate, renderRateCap);
+
+  printf("%-16s %8s %9s %9s %9s %10s %10s | per iteration: %6s %6s %7s %7s %6s %6s %6s %6s %5s\n",
+         "state", "iters", "host ns", "p99 ns", "max ns", "device us", "max dev us",
+         "lcd", "mxXfer", "mxBytes", "millis", "adc", "dread", "eeW", "imu", "tone");
+  for (uint8_t i = 0; i < stateCount; i++) {
+    StateStats &s = stats[i];
+    if (s.iterations == 0) continue;
+    std::vector<uint32_t> sorted = s.hostNanos;
+    std::sort(sorted.begin(), sorted.end());
+    uint64_t sum = 0;
+    for (uint32_t ns : sorted) sum += ns;
+    double n = s.iterations;
+    const HostCallCounters &c = s.calls;
+    printf("%-16s %8u %9.0f %9u %9u %10.0f %10u | %21.2f %6.2f %7.1f %7.2f %6.2f %6.2f %6.3f %6.3f %5.2f\n",
+           stateNames[i], s.iterations, sum / n, sorted[(size_t)(sorted.size() * 0.99)],
+           sorted.back(), s.deviceMicros / n, s.maxDeviceMicros,
+           (c.lcdClears + c.lcdCommands + c.lcdChars) / n, c.matrixTransfers / n, c.matrixBytes / n,
+           c.millisCalls / n, c.analogReads / n, c.digitalReads / n, c.eepromWrites / n,
+           c.imuReads / n, c.tones / n);
+  }
+
+  const MatrixDisplayStats &m = matrix.stats();
+  printf("\nMatrix: %lu frames, %lu skipped unchanged (%.1f%%), %lu rows sent, %lu bytes shifted (%.2f bytes/frame)\n",
+         (unsigned long)m.framesPushed, (unsigned long)m.framesSkipped,
+         m.framesPushed ? 100.0 * m.framesSkipped / m.framesPushed : 0.0,
+         (unsigned long)m.rowsSent, (unsigned long)m.bytesShifted,
+         m.framesPushed ? (double)m.bytesShifted / m.framesPushed : 0.0);
+
+  const LcdBufferStats &l = lcd.stats();
+  printf("LCD: %lu flushes, %lu cut by the %u us budget, %lu chars and %lu commands sent\n",
+         (unsigned long)l.flushes, (unsigned long)l.flushesCut, lcdFlushBudgetMicros,
+         (unsigned long)l.charsSent, (unsigned long)l.commandsSent);
+
+  const EepromQueueStats &e = eeprom.stats();
+  printf("EEPROM: %lu bytes queued, %lu unchanged, %lu coalesced, max depth %u, %u full stalls\n",
+         (unsigned long)e.bytesQueued, (unsigned long)e.bytesUnchanged, (unsigned long)e.bytesCoalesced,
+         e.maxDepth, e.fullStalls);
+
+  printf("\n%-12s %7s %9s %9s %9s %12s\n", "task", "period", "runs", "overruns", "dropped", "max run us");
+  for (uint8_t i = 0; i < scheduler.count(); i++) {
+    const Task &t = scheduler.task(i);
+    printf("%-12s %7u %9lu %9u %9u %12u\n", taskNames[i], t.periodMs, (unsigned long)t.runs,
+           t.overruns, t.dropped, t.maxRunMicros);
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+// Times the procedural maze generator from 8x8 up to 256x256 and reports
+// the memory it needs: the bit-packed row buffer plus the bounded path stack.
+// Every maze is checked to be perfect (all rooms connected, no loops).
+//
+// Usage: maze_gen_bench [--runs N]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "maze_gen.h"
+
+struct XorShiftRange {
+  uint32_t state;
+  uint8_t operator()(uint8_t n) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state % n;
+  }
+};
+
+// Flood fill from (1, 1); a perfect maze on R rooms has exactly 2R - 1 open
+// cells and every one of them is reachable.
+template <typename Word>
+static bool isPerfect(const std::vector<Word> &rows, uint16_t stride, uint16_t width, uint16_t height) {
+  uint32_t open = 0;
+  for (uint16_t r = 0; r < height; r++)
+    for (uint16_t c = 0; c < width; c++)
+      if (!mazeIsWall(rows.data(), stride, c, r)) open++;
+  if (open != 2u * mazeRoomCount(width, height) - 1) return false;
+
+  std::vector<uint8_t> seen(width * height, 0);
+  std::vector<uint32_t> queue(1, width + 1);
+  seen[width + 1] = 1;
+  for (size_t i = 0; i < queue.size(); i++) {
+    uint16_t c = queue[i] % width, r = queue[i] / width;
+    const int dc[4] = { 1, -1, 0, 0 }, dr[4] = { 0, 0, 1, -1 };
+    for (int d = 0; d < 4; d++) {
+      uint16_t nc = c + dc[d], nr = r + dr[d];
+      if (nc >= width || nr >= height || seen[nr * width + nc]) continue;
+      if (mazeIsWall(rows.data(), stride, nc, nr)) continue;
+      seen[nr * width + nc] = 1;
+      queue.push_back(nr * width + nc);
+    }
+  }
+  return queue.size() == open;
+}
+
+template <typename Word>
+static void run(uint16_t size, uint32_t runs) {
+  const uint16_t bits = sizeof(Word) * 8;
+  const uint16_t stride = (size + bits - 1) / bits;
+  std::vector<Word> rows(stride * size);
+  std::vector<uint8_t> stack(mazeStackBytes(size, size));
+  XorShiftRange rng = { 0x9E3779B9u ^ size };
+
+  uint16_t peak = 0;
+  bool perfect = true;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < runs; i++) {
+    uint16_t depth = generateMaze(rows.data(), stride, size, size, stack.data(), stack.size(), rng);
+    if (depth > peak) peak = depth;
+    if (i == 0) perfect = isPerfect(rows, stride, size, size);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double us = std::chrono::duration<double, std::micro>(t1 - t0).count() / runs;
+
+  size_t rowBytes = rows.size() * sizeof(Word);
+  printf("%3ux%-3u %2u-bit rows  %10.2f us/maze  rows %5zu B  stack %4zu B (peak %5u of %5u steps)  total %5zu B%s\n",
+         size, size, bits, us, rowBytes, stack.size(), peak, mazeRoomCount(size, size),
+         rowBytes + stack.size(), perfect ? "" : "  NOT PERFECT");
+}
+
+int main(int argc, char **argv) {
+  uint32_t runs = 2000;
+  if (argc == 3 && !strcmp(argv[1], "--runs")) runs = strtoul(argv[2], nullptr, 10);
+  else if (argc != 1) {
+    fprintf(stderr, "usage: %s [--runs N]\n", argv[0]);
+    return 1;
+  }
+  // The row word the firmware would pick for each width, then 64-bit words
+  // for sizes only the host handles
+  run<uint8_t>(8, runs);
+  run<uint16_t>(16, runs);
+  run<uint32_t>(24, runs);
+  run<uint32_t>(32, runs);
+  run<uint64_t>(64, runs);
+  run<uint64_t>(128, runs / 4 + 1);
+  run<uint64_t>(256, runs / 16 + 1);
+  return 0;
+}
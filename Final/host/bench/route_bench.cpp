@@ -0,0 +1,159 @@
+// Times the par route solver (route_solver.h) on every level, built-in and
+// generated, with stars placed the way the game places them, from 2 up to
+// routeMaxStars. For each star count it reports the bitboard floods, the
+// board's branch and bound (unbounded and within routeSearchBudget nodes)
+// and Held-Karp, and checks the search against Held-Karp's exact length.
+//
+// The board has no clock worth timing this on, so the budgeted search is
+// also priced for it from what it does: the "board ms" for a whole search,
+// and the worst "slice ms" for routeSliceNodes nodes, which is what one game
+// tick spends on it. Held-Karp needs 2^stars * stars words, so it only
+// ever runs here.
+//
+// Usage: route_bench [--trials N] [--node-limit N]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "hal_host.h"
+#include "main.cpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static double microsSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+}
+
+// Rough AVR cost of the search at 16 MHz, counted by hand from the loops in
+// route_solver.cpp rather than measured: a distance is an 8x8 multiply, a
+// shift and a 16-bit load plus the loop step around it, and a node is its
+// frame and the bit scans between its lookups
+const uint32_t avrCyclesPerLookup = 40;
+const uint32_t avrCyclesPerNode = 200;
+const double avrCyclesPerMs = 16000;
+
+static double avrMillis(uint32_t nodes, uint32_t lookups) {
+  return (nodes * (double)avrCyclesPerNode + lookups * (double)avrCyclesPerLookup) / avrCyclesPerMs;
+}
+
+struct RouteStats {
+  uint32_t trials = 0;
+  uint32_t stars = 0;
+  double floodUs = 0, searchUs = 0, budgetUs = 0, heldKarpUs = 0;
+  uint64_t nodes = 0;
+  uint32_t maxNodes = 0;
+  uint32_t unfinished = 0; // Unbounded search hit --node-limit
+  uint32_t budgetExact = 0;
+  double worstExcess = 0; // Budgeted length over optimal
+  double boardMs = 0;
+  double worstSliceMs = 0;
+  uint32_t wrong = 0;
+};
+
+static bool runLevel(const LevelDef *defs, uint8_t index, uint8_t stars, uint32_t trials, uint32_t nodeLimit,
+                     RouteStats &st) {
+  uint16_t dist[routeDistanceCount(routeMaxStars + 2)];
+  std::vector<uint16_t> table((1ul << stars) * stars);
+  for (uint32_t t = 0; t < trials; t++) {
+    randomSeed(t * 7919 + index * 31 + stars + 1);
+    memcpy_P(&currentLevel, &defs[index], sizeof(LevelDef));
+    if (currentLevel.generate) currentLevel.generate();
+    placeEntities(stars);
+
+    auto t0 = Clock::now();
+    uint8_t placed = currentLevel.routeDistances(dist, routeMaxStars);
+    st.floodUs += microsSince(t0);
+
+    t0 = Clock::now();
+    RouteResult full = routeSearch(dist, placed, nodeLimit);
+    st.searchUs += microsSince(t0);
+
+    t0 = Clock::now();
+    RouteResult budgeted = routeSearch(dist, placed, routeSearchBudget);
+    st.budgetUs += microsSince(t0);
+    st.boardMs += avrMillis(budgeted.nodes, budgeted.lookups);
+
+    // Again the way the game runs it, a tick's worth of nodes at a time
+    RouteSearch sliced;
+    sliced.begin(dist, placed, routeSearchBudget);
+    RouteResult before = sliced.result();
+    for (bool done = sliced.done(); !done;) {
+      done = sliced.run(routeSliceNodes);
+      RouteResult after = sliced.result();
+      double ms = avrMillis(after.nodes - before.nodes, after.lookups - before.lookups);
+      if (ms > st.worstSliceMs) st.worstSliceMs = ms;
+      before = after;
+    }
+    if (before.length != budgeted.length || before.nodes != budgeted.nodes) st.wrong++;
+
+    t0 = Clock::now();
+    uint16_t exact = routeHeldKarp(dist, placed, table.data());
+    st.heldKarpUs += microsSince(t0);
+
+    if (exact == routeUnreachable) {
+      fprintf(stderr, "level %u: a star or the exit is unreachable\n", index + 1);
+      return false;
+    }
+    st.trials++;
+    st.stars += placed;
+    st.nodes += full.nodes;
+    if (full.nodes > st.maxNodes) st.maxNodes = full.nodes;
+    if (!full.exact) st.unfinished++;
+    else if (full.length != exact) st.wrong++;
+    if (budgeted.exact) st.budgetExact++;
+    if (budgeted.length < exact) st.wrong++;
+    double excess = 100.0 * (budgeted.length - exact) / exact;
+    if (excess > st.worstExcess) st.worstExcess = excess;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  uint32_t trials = 100;
+  uint32_t nodeLimit = 50000000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--trials") && i + 1 < argc) trials = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--node-limit") && i + 1 < argc) nodeLimit = strtoul(argv[++i], nullptr, 10);
+    else {
+      fprintf(stderr, "usage: %s [--trials N] [--node-limit N]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (trials < 1) trials = 1;
+
+  printf("%u trials per row, board budget %u nodes in slices of %u; times are host us per level\n", trials,
+         routeSearchBudget, routeSliceNodes);
+  printf("and estimated board ms (%u cycles a node, %u a distance)\n", avrCyclesPerNode, avrCyclesPerLookup);
+  printf("%-10s %-6s %5s %6s | %8s %10s %10s %9s | %8s %7s %7s %8s %8s | %9s\n", "level", "size", "stars",
+         "placed", "flood", "nodes avg", "nodes max", "search", "budget", "exact", "excess", "board ms", "slice ms",
+         "held-karp");
+
+  int status = 0;
+  for (uint8_t set = 0; set < 2; set++) {
+    const LevelDef *defs = set ? generatedLevelDefs : levelDefs;
+    for (uint8_t index = 0; index < totalLevels; index++) {
+      for (uint8_t stars = 2; stars <= routeMaxStars; stars += 2) {
+        RouteStats st;
+        if (!runLevel(defs, index, stars, trials, nodeLimit, st)) return 1;
+        char name[16];
+        snprintf(name, sizeof(name), "%s %u", set ? "random" : "built-in", index + 1);
+        char size[8];
+        snprintf(size, sizeof(size), "%ux%u", currentLevel.width, currentLevel.height);
+        printf("%-10s %-6s %5u %6.1f | %8.1f %10.0f %10u %9.1f | %8.1f %6.1f%% %6.1f%% %8.1f %8.2f | %9.1f", name,
+               size, stars, (double)st.stars / st.trials, st.floodUs / st.trials, (double)st.nodes / st.trials,
+               st.maxNodes, st.searchUs / st.trials, st.budgetUs / st.trials, 100.0 * st.budgetExact / st.trials,
+               st.worstExcess, st.boardMs / st.trials, st.worstSliceMs, st.heldKarpUs / st.trials);
+        if (st.unfinished) printf("  %u over node limit", st.unfinished);
+        if (st.wrong) {
+          printf("  %u WRONG", st.wrong);
+          status = 1;
+        }
+        printf("\n");
+      }
+    }
+  }
+  return status;
+}
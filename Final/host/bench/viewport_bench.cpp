@@ -0,0 +1,84 @@
+// Compares the word-parallel viewport kernel against the per-cell loop it
+// replaced, for 16, 32 and 64 column level rows.
+//
+// Usage: viewport_bench [--frames N]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "viewport.h"
+
+// The original updateMatrixViewport() inner loop, generalised to RowT
+template <typename RowT>
+static void extractPerCell(const RowT *rows, uint8_t dim, uint8_t colOffset, uint8_t rowOffset,
+                           const RowT *overlay, uint8_t *out) {
+  const uint8_t bits = sizeof(RowT) * 8;
+  memset(out, 0, 8);
+  for (uint8_t r = 0; r < 8; r++) {
+    uint8_t levelR = r + rowOffset;
+    RowT rowData = overlay[r];
+    if (levelR < dim) rowData |= rows[levelR];
+    for (uint8_t c = 0; c < 8; c++) {
+      uint8_t levelC = c + colOffset;
+      if (levelC < dim && (rowData & ((RowT)1 << (bits - 1 - levelC)))) out[r] |= (1 << (7 - c));
+    }
+  }
+}
+
+template <typename RowT>
+static void run(uint32_t frames) {
+  const uint8_t dim = sizeof(RowT) * 8;
+  std::vector<RowT> rows(dim);
+  srand(dim);
+  for (RowT &row : rows) {
+    row = 0;
+    for (uint8_t b = 0; b < sizeof(RowT); b++) row = (RowT)((row << 8) | (rand() & 0xFF));
+  }
+  RowT overlay[8] = {};
+  overlay[3] = levelColumnMask<RowT>(dim / 2);
+
+  uint8_t a[8], b[8];
+  bool mismatch = false;
+  for (uint8_t co = 0; co + 8 <= dim; co++) {
+    for (uint8_t ro = 0; ro + 8 <= dim; ro++) {
+      extractPerCell<RowT>(rows.data(), dim, co, ro, overlay, a);
+      extractViewport<RowT>(rows.data(), dim, dim, co, ro, overlay, b);
+      if (memcmp(a, b, 8)) mismatch = true;
+    }
+  }
+
+  uint32_t checksum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t f = 0; f < frames; f++) {
+    extractPerCell<RowT>(rows.data(), dim, f % (dim - 7), (f / 3) % (dim - 7), overlay, a);
+    checksum += a[f & 7];
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (uint32_t f = 0; f < frames; f++) {
+    extractViewport<RowT>(rows.data(), dim, dim, f % (dim - 7), (f / 3) % (dim - 7), overlay, b);
+    checksum += b[f & 7];
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  double perCell = std::chrono::duration<double, std::nano>(t1 - t0).count() / frames;
+  double word = std::chrono::duration<double, std::nano>(t2 - t1).count() / frames;
+  printf("%2u columns: per-cell %7.1f ns/frame, word %6.1f ns/frame, %5.1fx%s\n",
+         dim, perCell, word, perCell / word, mismatch ? "  MISMATCH" : "");
+  if (checksum == 1) printf("\n"); // keep the loops observable
+}
+
+int main(int argc, char **argv) {
+  uint32_t frames = 2000000;
+  if (argc == 3 && !strcmp(argv[1], "--frames")) frames = strtoul(argv[2], nullptr, 10);
+  else if (argc != 1) {
+    fprintf(stderr, "usage: %s [--frames N]\n", argv[0]);
+    return 1;
+  }
+  run<uint16_t>(frames);
+  run<uint32_t>(frames);
+  run<uint64_t>(frames);
+  return 0;
+}
@@ -0,0 +1,663 @@
+#include "hal_host.h"
+
+#include <Arduino.h>
+#include <LiquidCrystal.h>
+#include <EEPROM.h>
+#include <Wire.h>
+
+#include <string>
+
+HostCallCounters hostCounters;
+
+HostCostModel hostCost = {
+  /* loopOverhead   */ 20,
+  /* analogRead     */ 112,
+  /* digitalRead    */ 4,
+  /* digitalWrite   */ 4,
+  /* lcdClear       */ 2000,
+  /* lcdByte        */ 240,
+  /* eepromWrite    */ 3300,
+  /* i2cByte        */ 90,
+  /* tone           */ 10
+};
+
+static uint64_t clockMicros = 0;
+static const uint8_t pinCount = 20;
+static uint16_t analogLevels[pinCount];
+static uint8_t digitalLevels[pinCount];
+static bool pinsInitialized = false;
+static bool imuPresent = true;
+static float accelX = 0;
+static float accelY = 0;
+static float accelZ = 9.81f;
+static uint16_t buzzerFrequency = 0;
+static unsigned long randomState = 1;
+
+static void initPins() {
+  if (pinsInitialized) return;
+  for (uint8_t i = 0; i < pinCount; i++) {
+    analogLevels[i] = 512;
+    digitalLevels[i] = HIGH;
+  }
+  pinsInitialized = true;
+}
+
+static uint8_t analogPinIndex(uint8_t pin) {
+  // analogRead accepts both channel numbers and A0..A5
+  return pin < A0 ? pin + A0 : pin;
+}
+
+void hostResetCounters() {
+  memset(&hostCounters, 0, sizeof(hostCounters));
+}
+
+uint64_t hostMicros() {
+  return clockMicros;
+}
+
+void hostAdvanceMicros(uint32_t us) {
+  clockMicros += us;
+}
+
+void hostSetAnalog(uint8_t pin, uint16_t value) {
+  initPins();
+  uint8_t idx = analogPinIndex(pin);
+  if (idx < pinCount) analogLevels[idx] = value;
+}
+
+static void (*interruptHandlers[2])() = { nullptr, nullptr };
+static int interruptModes[2];
+
+void hostSetDigital(uint8_t pin, uint8_t level) {
+  initPins();
+  if (pin >= pinCount) return;
+  uint8_t previous = digitalLevels[pin];
+  digitalLevels[pin] = level;
+
+  int irq = digitalPinToInterrupt(pin);
+  if (irq < 0 || !interruptHandlers[irq] || previous == level) return;
+  int mode = interruptModes[irq];
+  if (mode == CHANGE || (mode == RISING && level == HIGH) || (mode == FALLING && level == LOW)) {
+    interruptHandlers[irq]();
+  }
+}
+
+void hostSetImuPresent(bool present) {
+  imuPresent = present;
+}
+
+void hostSetAcceleration(float x, float y, float z) {
+  accelX = x;
+  accelY = y;
+  accelZ = z;
+}
+
+uint16_t hostBuzzerFrequency() {
+  return buzzerFrequency;
+}
+
+// MAX7219 chain on the pins given to hostAttachMax7219(). Each device is a
+// 16-bit shift register; bits go in at the first device's DIN and out of
+// each device into the next. LOAD's rising edge latches every device's
+// word into the register it addresses.
+
+static const uint8_t max7219MaxDevices = 8;
+
+static struct {
+  bool attached;
+  uint8_t din, clk, load;
+  uint8_t devices;
+  uint16_t shift[max7219MaxDevices];
+  uint8_t registers[max7219MaxDevices][16];
+  uint16_t bitsShifted; // Since LOAD last went high
+} max7219;
+
+void hostAttachMax7219(uint8_t din, uint8_t clk, uint8_t load, uint8_t devices) {
+  memset(&max7219, 0, sizeof(max7219));
+  max7219.attached = true;
+  max7219.din = din;
+  max7219.clk = clk;
+  max7219.load = load;
+  max7219.devices = devices == 0 || devices > max7219MaxDevices ? max7219MaxDevices : devices;
+}
+
+uint8_t hostMax7219Register(uint8_t device, uint8_t reg) {
+  return device < max7219MaxDevices && reg < 16 ? max7219.registers[device][reg] : 0;
+}
+
+static void max7219ShiftBit(bool bit) {
+  for (uint8_t d = 0; d < max7219.devices; d++) {
+    bool out = max7219.shift[d] & 0x8000;
+    max7219.shift[d] = (uint16_t)(max7219.shift[d] << 1) | bit;
+    bit = out;
+  }
+  max7219.bitsShifted++;
+}
+
+static void max7219Latch() {
+  if (max7219.bitsShifted == 0) return;
+  for (uint8_t d = 0; d < max7219.devices; d++) {
+    uint8_t reg = (max7219.shift[d] >> 8) & 0x0F;
+    max7219.registers[d][reg] = max7219.shift[d] & 0xFF;
+  }
+  hostCounters.matrixTransfers++;
+  hostCounters.matrixBytes += max7219.bitsShifted / 8;
+  max7219.bitsShifted = 0;
+}
+
+// Arduino core
+
+void pinMode(uint8_t, uint8_t) {}
+
+void attachInterrupt(uint8_t interruptNum, void (*handler)(), int mode) {
+  if (interruptNum >= 2) return;
+  interruptHandlers[interruptNum] = handler;
+  interruptModes[interruptNum] = mode;
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+  if (interruptNum < 2) interruptHandlers[interruptNum] = nullptr;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  initPins();
+  hostCounters.digitalWrites++;
+  hostAdvanceMicros(hostCost.digitalWrite);
+  if (pin >= pinCount) return;
+  bool rising = !digitalLevels[pin] && val;
+  digitalLevels[pin] = val;
+  if (!max7219.attached) return;
+  if (pin == max7219.clk && rising) max7219ShiftBit(digitalLevels[max7219.din]);
+  if (pin == max7219.load && rising) max7219Latch();
+}
+
+int digitalRead(uint8_t pin) {
+  initPins();
+  hostCounters.digitalReads++;
+  hostAdvanceMicros(hostCost.digitalRead);
+  return pin < pinCount ? digitalLevels[pin] : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  initPins();
+  hostCounters.analogReads++;
+  hostAdvanceMicros(hostCost.analogRead);
+  uint8_t idx = analogPinIndex(pin);
+  return idx < pinCount ? analogLevels[idx] : 0;
+}
+
+void analogWrite(uint8_t, int) {
+  hostCounters.analogWrites++;
+}
+
+unsigned long millis() {
+  hostCounters.millisCalls++;
+  return (unsigned long)(clockMicros / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)clockMicros;
+}
+
+void delay(unsigned long ms) {
+  hostAdvanceMicros(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostAdvanceMicros(us);
+}
+
+// Charged as the 24 digitalWrite()s the core spends on a byte
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val) {
+  hostCounters.digitalWrites += 24;
+  hostAdvanceMicros(24 * hostCost.digitalWrite);
+  for (uint8_t i = 0; i < 8; i++) {
+    bool bit = bitOrder == MSBFIRST ? val & (0x80 >> i) : val & (1 << i);
+    if (dataPin < pinCount) digitalLevels[dataPin] = bit;
+    if (max7219.attached && dataPin == max7219.din && clockPin == max7219.clk) max7219ShiftBit(bit);
+  }
+  if (clockPin < pinCount) digitalLevels[clockPin] = LOW;
+}
+
+void tone(uint8_t, unsigned int frequency, unsigned long) {
+  hostCounters.tones++;
+  hostAdvanceMicros(hostCost.tone);
+  buzzerFrequency = frequency;
+}
+
+void noTone(uint8_t) {
+  buzzerFrequency = 0;
+}
+
+// Same Park-Miller generator as avr-libc so seeds reproduce device layouts
+static long nextRandom() {
+  long hi, lo, x;
+  x = (long)randomState;
+  if (x == 0) x = 123459876L;
+  hi = x / 127773L;
+  lo = x % 127773L;
+  x = 16807L * lo - 2836L * hi;
+  if (x < 0) x += 0x7fffffffL;
+  randomState = (unsigned long)x;
+  return x % 0x80000000UL;
+}
+
+long random(long howbig) {
+  if (howbig == 0) return 0;
+  return nextRandom() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) randomState = seed;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// Print
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::write(const char *str) {
+  if (str == nullptr) return 0;
+  return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+  return write(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::print(const char *str) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(int n, int base) {
+  return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0) {
+    size_t t = print('-');
+    return t + printNumber((unsigned long)(-n), DEC);
+  }
+  return printNumber((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::println() {
+  return write((const uint8_t *)"\r\n", 2);
+}
+
+size_t Print::println(const __FlashStringHelper *str) {
+  size_t n = print(str);
+  return n + println();
+}
+
+size_t Print::println(const char *str) {
+  size_t n = print(str);
+  return n + println();
+}
+
+size_t Print::println(int num, int base) {
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned int num, int base) {
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(long num, int base) {
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned long num, int base) {
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+// Serial
+
+HardwareSerial Serial;
+static const uint8_t serialBufferSize = 64; // One slot always stays free
+static uint32_t serialByteMicros = 0;       // 10 bits on the wire, 0 until begin()
+static uint64_t serialIdleAt = 0;           // When the last queued byte is out
+static std::string serialOutput;
+
+static uint8_t serialQueued() {
+  if (serialIdleAt <= clockMicros) return 0;
+  return (uint8_t)((serialIdleAt - clockMicros + serialByteMicros - 1) / serialByteMicros);
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  serialByteMicros = (10000000UL + baud / 2) / baud;
+  serialIdleAt = clockMicros;
+}
+
+int HardwareSerial::availableForWrite() {
+  if (serialByteMicros == 0) return 0;
+  return serialBufferSize - 1 - serialQueued();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serialByteMicros == 0) return 0;
+  // Full: block until the oldest byte has gone out
+  uint64_t roomAt = serialIdleAt - (uint64_t)(serialBufferSize - 2) * serialByteMicros;
+  if (serialQueued() >= serialBufferSize - 1 && roomAt > clockMicros) {
+    hostAdvanceMicros((uint32_t)(roomAt - clockMicros));
+  }
+  serialIdleAt = (serialIdleAt > clockMicros ? serialIdleAt : clockMicros) + serialByteMicros;
+  hostCounters.serialBytes++;
+  serialOutput += (char)c;
+  return 1;
+}
+
+const char *hostSerialOutput() {
+  return serialOutput.c_str();
+}
+
+void hostClearSerialOutput() {
+  serialOutput.clear();
+}
+
+// LiquidCrystal
+
+LiquidCrystal::LiquidCrystal(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t)
+  : cursorCol(0), cursorRow(0) {
+  for (uint8_t r = 0; r < rows; r++) {
+    memset(text[r], ' ', cols);
+    text[r][cols] = '\0';
+  }
+}
+
+void LiquidCrystal::begin(uint8_t, uint8_t) {
+  // Power-on wait plus the 4-bit initialisation sequence
+  hostAdvanceMicros(50000);
+  hostCounters.lcdCommands += 8;
+  hostAdvanceMicros(8 * hostCost.lcdByte);
+  clear();
+}
+
+void LiquidCrystal::clear() {
+  hostCounters.lcdClears++;
+  hostAdvanceMicros(hostCost.lcdClear);
+  for (uint8_t r = 0; r < rows; r++) memset(text[r], ' ', cols);
+  cursorCol = 0;
+  cursorRow = 0;
+}
+
+void LiquidCrystal::home() {
+  hostCounters.lcdCommands++;
+  hostAdvanceMicros(hostCost.lcdClear);
+  cursorCol = 0;
+  cursorRow = 0;
+}
+
+void LiquidCrystal::setCursor(uint8_t col, uint8_t row) {
+  hostCounters.lcdCommands++;
+  hostAdvanceMicros(hostCost.lcdByte);
+  cursorCol = col;
+  cursorRow = row < rows ? row : rows - 1;
+}
+
+void LiquidCrystal::cursor() {
+  hostCounters.lcdCommands++;
+  hostAdvanceMicros(hostCost.lcdByte);
+}
+
+void LiquidCrystal::noCursor() {
+  hostCounters.lcdCommands++;
+  hostAdvanceMicros(hostCost.lcdByte);
+}
+
+void LiquidCrystal::blink() {
+  hostCounters.lcdCommands++;
+  hostAdvanceMicros(hostCost.lcdByte);
+}
+
+void LiquidCrystal::noBlink() {
+  hostCounters.lcdCommands++;
+  hostAdvanceMicros(hostCost.lcdByte);
+}
+
+size_t LiquidCrystal::write(uint8_t c) {
+  hostCounters.lcdChars++;
+  hostAdvanceMicros(hostCost.lcdByte);
+  // DDRAM keeps 40 addresses per line; only the first 16 are visible
+  if (cursorCol < cols) text[cursorRow][cursorCol] = (char)c;
+  if (cursorCol < 40) cursorCol++;
+  return 1;
+}
+
+// EEPROM
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass() {
+  memset(cells, 0xFF, sizeof(cells));
+}
+
+uint8_t EEPROMClass::read(int idx) {
+  hostCounters.eepromReads++;
+  return (idx >= 0 && idx < size) ? cells[idx] : 0xFF;
+}
+
+void EEPROMClass::write(int idx, uint8_t val) {
+  if (idx < 0 || idx >= size) return;
+  hostCounters.eepromWrites++;
+  hostAdvanceMicros(hostCost.eepromWrite);
+  cells[idx] = val;
+}
+
+void EEPROMClass::update(int idx, uint8_t val) {
+  if (read(idx) != val) write(idx, val);
+}
+
+// I2C + IMU
+
+// Simulated MPU6050 at 0x68: enough of the register map for the firmware's
+// FIFO driver. Samples are produced lazily from the virtual clock.
+static const uint8_t mpuAddress = 0x68;
+static const uint16_t mpuFifoSize = 1024;
+static uint8_t mpuRegs[128];
+static uint8_t mpuFifo[mpuFifoSize];
+static uint16_t mpuFifoHead = 0;
+static uint16_t mpuFifoCount = 0;
+static uint8_t mpuPointer = 0;
+static uint64_t mpuLastSample = 0;
+static bool mpuInitialized = false;
+
+static void mpuReset() {
+  memset(mpuRegs, 0, sizeof(mpuRegs));
+  mpuRegs[0x6B] = 0x40; // PWR_MGMT_1: asleep after power-up
+  mpuRegs[0x75] = mpuAddress; // WHO_AM_I
+  mpuFifoHead = 0;
+  mpuFifoCount = 0;
+  mpuLastSample = clockMicros;
+  mpuInitialized = true;
+}
+
+static int16_t mpuRawAccel(float metersPerSecond2) {
+  // AFS_SEL 0..3 is +-2/4/8/16 g
+  float countsPerG = 16384 >> ((mpuRegs[0x1C] >> 3) & 3);
+  float raw = metersPerSecond2 / 9.80665f * countsPerG;
+  if (raw > 32767) raw = 32767;
+  if (raw < -32768) raw = -32768;
+  return (int16_t)raw;
+}
+
+static void mpuPushFifo(uint8_t value) {
+  if (mpuFifoCount == mpuFifoSize) {
+    // Full: the oldest byte is overwritten (FIFO_OFLOW_INT)
+    mpuFifoHead = (mpuFifoHead + 1) % mpuFifoSize;
+    mpuFifoCount--;
+    mpuRegs[0x3A] |= 0x10;
+  }
+  mpuFifo[(mpuFifoHead + mpuFifoCount) % mpuFifoSize] = value;
+  mpuFifoCount++;
+}
+
+// Queues the samples taken since the last access
+static void mpuUpdateFifo() {
+  bool sampling = !(mpuRegs[0x6B] & 0x40) && (mpuRegs[0x6A] & 0x40) && (mpuRegs[0x23] & 0x08);
+  uint8_t dlpf = mpuRegs[0x1A] & 7;
+  uint32_t baseHz = (dlpf == 0 || dlpf == 7) ? 8000 : 1000;
+  uint64_t period = 1000000ull * (1 + mpuRegs[0x19]) / baseHz;
+  if (!sampling) {
+    mpuLastSample = clockMicros;
+    return;
+  }
+  while (clockMicros - mpuLastSample >= period) {
+    mpuLastSample += period;
+    int16_t axes[3] = { mpuRawAccel(accelX), mpuRawAccel(accelY), mpuRawAccel(accelZ) };
+    for (uint8_t i = 0; i < 3; i++) {
+      mpuPushFifo((uint8_t)((uint16_t)axes[i] >> 8));
+      mpuPushFifo((uint8_t)axes[i]);
+    }
+  }
+}
+
+static void mpuWrite(uint8_t reg, uint8_t value) {
+  if (reg == 0x6B && (value & 0x80)) {
+    mpuReset();
+    return;
+  }
+  if (reg == 0x74) {
+    mpuPushFifo(value);
+    return;
+  }
+  mpuRegs[reg & 0x7F] = value;
+  if (reg == 0x6A && (value & 0x04)) {
+    // FIFO_RESET self-clears
+    mpuFifoHead = 0;
+    mpuFifoCount = 0;
+    mpuRegs[0x6A] &= ~0x04;
+  }
+}
+
+static uint8_t mpuRead(uint8_t reg) {
+  switch (reg) {
+    case 0x3A: {
+      uint8_t status = mpuRegs[0x3A];
+      mpuRegs[0x3A] = 0; // cleared on read
+      return status;
+    }
+    case 0x3B: return (uint16_t)mpuRawAccel(accelX) >> 8;
+    case 0x3C: return mpuRawAccel(accelX) & 0xFF;
+    case 0x3D: return (uint16_t)mpuRawAccel(accelY) >> 8;
+    case 0x3E: return mpuRawAccel(accelY) & 0xFF;
+    case 0x3F: return (uint16_t)mpuRawAccel(accelZ) >> 8;
+    case 0x40: return mpuRawAccel(accelZ) & 0xFF;
+    case 0x72: return mpuFifoCount >> 8;
+    case 0x73: return mpuFifoCount & 0xFF;
+    case 0x74: {
+      if (mpuFifoCount == 0) return 0;
+      uint8_t value = mpuFifo[mpuFifoHead];
+      mpuFifoHead = (mpuFifoHead + 1) % mpuFifoSize;
+      mpuFifoCount--;
+      return value;
+    }
+    default: return mpuRegs[reg & 0x7F];
+  }
+}
+
+TwoWire Wire;
+
+TwoWire::TwoWire() : clockHz(100000), txAddress(0), txLength(0), rxLength(0), rxIndex(0) {}
+
+void TwoWire::chargeBytes(uint8_t count) {
+  // Eight data bits plus ACK per byte
+  hostCounters.i2cBytes += count;
+  hostAdvanceMicros((uint64_t)count * hostCost.i2cByte * 100000 / clockHz);
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddress = address;
+  txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLength >= bufferLength) return 0;
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  chargeBytes(1 + txLength);
+  if (txAddress != mpuAddress || !imuPresent) return 2;
+  if (!mpuInitialized) mpuReset();
+  mpuUpdateFifo();
+  if (txLength > 0) mpuPointer = txBuffer[0];
+  for (uint8_t i = 1; i < txLength; i++) {
+    mpuWrite(mpuPointer, txBuffer[i]);
+    if (mpuPointer != 0x74) mpuPointer++;
+  }
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+  rxIndex = 0;
+  rxLength = 0;
+  if (quantity > bufferLength) quantity = bufferLength;
+  chargeBytes(1);
+  if (address != mpuAddress || !imuPresent) return 0;
+  if (!mpuInitialized) mpuReset();
+  hostCounters.imuReads++;
+  chargeBytes(quantity);
+  mpuUpdateFifo();
+  for (uint8_t i = 0; i < quantity; i++) {
+    rxBuffer[i] = mpuRead(mpuPointer);
+    // Burst reads auto-increment, except on the FIFO data port
+    if (mpuPointer != 0x74) mpuPointer++;
+  }
+  rxLength = quantity;
+  return quantity;
+}
+
+int TwoWire::available() {
+  return rxLength - rxIndex;
+}
+
+int TwoWire::read() {
+  return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
@@ -0,0 +1,67 @@
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+// Control surface of the host hardware layer: scripted inputs, the virtual
+// clock and per-peripheral call counters.
+
+#include <stdint.h>
+
+struct HostCallCounters {
+  uint32_t millisCalls;
+  uint32_t analogReads;
+  uint32_t digitalReads;
+  uint32_t digitalWrites;
+  uint32_t analogWrites;
+  uint32_t tones;
+  uint32_t lcdClears;
+  uint32_t lcdCommands;
+  uint32_t lcdChars;
+  uint32_t matrixTransfers; // LOAD pulses that latched data
+  uint32_t matrixBytes;
+  uint32_t eepromReads;
+  uint32_t eepromWrites;
+  uint32_t imuReads;       // read transactions addressed to the MPU6050
+  uint32_t i2cBytes;
+  uint32_t serialBytes;
+};
+
+// Approximate ATmega328P @ 16 MHz cost of each blocking call, in microseconds.
+// Charged to the virtual clock so millis() advances the way it would on the Uno.
+struct HostCostModel {
+  uint32_t loopOverhead;
+  uint32_t analogRead;
+  uint32_t digitalRead;
+  uint32_t digitalWrite;
+  uint32_t lcdClear;
+  uint32_t lcdByte;        // one 4-bit-mode command or character
+  uint32_t eepromWrite;
+  uint32_t i2cByte;        // one byte + ACK at 100 kHz, scaled by Wire.setClock()
+  uint32_t tone;
+};
+
+extern HostCallCounters hostCounters;
+extern HostCostModel hostCost;
+
+void hostResetCounters();
+
+uint64_t hostMicros();
+void hostAdvanceMicros(uint32_t us);
+
+void hostSetAnalog(uint8_t pin, uint16_t value);
+void hostSetDigital(uint8_t pin, uint8_t level);
+void hostSetImuPresent(bool present);
+void hostSetAcceleration(float x, float y, float z);
+
+uint16_t hostBuzzerFrequency();
+
+// Puts a chain of `devices` MAX7219s on these pins (the first is on DIN);
+// nothing listens to the pins until then. hostMax7219Register() reads back
+// what a device holds in a register.
+void hostAttachMax7219(uint8_t din, uint8_t clk, uint8_t load, uint8_t devices);
+uint8_t hostMax7219Register(uint8_t device, uint8_t reg);
+
+// Everything written to Serial since the last hostClearSerialOutput()
+const char *hostSerialOutput();
+void hostClearSerialOutput();
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include "Arduino.h"
+
+// 1 KB in-memory EEPROM matching the ATmega328P. Erased cells read 0xFF.
+class EEPROMClass {
+public:
+  static const uint16_t size = 1024;
+
+  EEPROMClass();
+
+  uint8_t read(int idx);
+  void write(int idx, uint8_t val);
+  void update(int idx, uint8_t val);
+  uint16_t length() const { return size; }
+
+  template <typename T> T &get(int idx, T &t) {
+    uint8_t *ptr = (uint8_t *)&t;
+    for (size_t i = 0; i < sizeof(T); i++) ptr[i] = read(idx + i);
+    return t;
+  }
+
+  template <typename T> const T &put(int idx, const T &t) {
+    const uint8_t *ptr = (const uint8_t *)&t;
+    for (size_t i = 0; i < sizeof(T); i++) update(idx + i, ptr[i]);
+    return t;
+  }
+
+  // Raw access for host tools; bypasses counters and timing
+  uint8_t *data() { return cells; }
+
+private:
+  uint8_t cells[size];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
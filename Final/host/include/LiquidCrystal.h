@@ -0,0 +1,35 @@
+#ifndef HOST_LIQUIDCRYSTAL_H
+#define HOST_LIQUIDCRYSTAL_H
+
+#include "Arduino.h"
+
+// In-memory HD44780. Keeps the visible 16x2 window so tests and benchmarks
+// can inspect what the firmware drew.
+class LiquidCrystal : public Print {
+public:
+  static const uint8_t cols = 16;
+  static const uint8_t rows = 2;
+
+  LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+
+  void begin(uint8_t cols, uint8_t rows);
+  void clear();
+  void home();
+  void setCursor(uint8_t col, uint8_t row);
+  void cursor();
+  void noCursor();
+  void blink();
+  void noBlink();
+
+  virtual size_t write(uint8_t c);
+  using Print::write;
+
+  const char *line(uint8_t row) const { return text[row]; }
+
+private:
+  char text[rows][cols + 1];
+  uint8_t cursorCol;
+  uint8_t cursorRow;
+};
+
+#endif
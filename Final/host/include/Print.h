@@ -0,0 +1,47 @@
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+// Flash strings live in ordinary memory on the host.
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define PSTR(string_literal) (string_literal)
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str);
+  // Bytes that can be written without blocking
+  virtual int availableForWrite() { return 0; }
+
+  size_t print(const __FlashStringHelper *str);
+  size_t print(const char *str);
+  size_t print(char c);
+  size_t print(unsigned char n, int base = DEC);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+
+  size_t println();
+  size_t println(const __FlashStringHelper *str);
+  size_t println(const char *str);
+  size_t println(int n, int base = DEC);
+  size_t println(unsigned int n, int base = DEC);
+  size_t println(long n, int base = DEC);
+  size_t println(unsigned long n, int base = DEC);
+
+private:
+  size_t printNumber(unsigned long n, uint8_t base);
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+// I2C master with the AVR Wire library's 32-byte buffers. The only device
+// on the bus is a simulated MPU6050 (register file plus a FIFO that fills at
+// the configured sample rate in virtual time), see hal_host.cpp.
+class TwoWire {
+public:
+  static const uint8_t bufferLength = 32;
+
+  TwoWire();
+
+  void begin() {}
+  void setClock(uint32_t hz) { clockHz = hz; }
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  // 0 on success, 2 when the address is not acknowledged
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  int available();
+  int read();
+
+private:
+  void chargeBytes(uint8_t count);
+
+  uint32_t clockHz;
+  uint8_t txAddress;
+  uint8_t txBuffer[bufferLength];
+  uint8_t txLength;
+  uint8_t rxBuffer[bufferLength];
+  uint8_t rxLength;
+  uint8_t rxIndex;
+};
+
+extern TwoWire Wire;
+
+#endif
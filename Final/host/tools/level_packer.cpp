@@ -0,0 +1,251 @@
+// Builds the level pack (see level_pack.h) from a text description of the
+// levels and writes it as the C++ header main.cpp includes. Each level is
+// checked to be solvable and gets its path table baked in: for every cell,
+// the next step towards the exit and its distance from the exit mod 4.
+//
+// Usage: level_packer LEVELS.txt OUT.h
+//
+// Input: lines starting with ';' are comments. "level N" starts a level
+// with N stars; the lines after it are its rows, '#' for wall, '.' for
+// open, 'S' for the start and 'E' for the exit, up to a blank line.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+static const unsigned tileSize = 4;
+static const unsigned maxDim = 32;    // star index and currentStarRows limit
+static const unsigned maxTiles = 256; // tile indices are bytes
+
+struct Level {
+  unsigned line = 0;
+  unsigned stars = 0;
+  std::vector<std::string> rows;
+  unsigned startCol = 0, startRow = 0, exitCol = 0, exitRow = 0;
+  std::vector<uint8_t> map;
+  std::vector<uint8_t> paths;
+  unsigned exitDistance = 0; // from the start
+};
+
+static bool fail(const char *path, unsigned line, const char *message) {
+  fprintf(stderr, "%s:%u: %s\n", path, line, message);
+  return false;
+}
+
+static bool parse(const char *path, std::vector<Level> &levels) {
+  std::ifstream in(path);
+  if (!in) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+  std::string text;
+  unsigned lineNo = 0;
+  Level *current = nullptr;
+  while (std::getline(in, text)) {
+    lineNo++;
+    if (!text.empty() && text.back() == '\r') text.pop_back();
+    if (!text.empty() && text[0] == ';') continue;
+    if (text.empty()) {
+      current = nullptr;
+      continue;
+    }
+    unsigned stars;
+    if (sscanf(text.c_str(), "level %u", &stars) == 1) {
+      levels.emplace_back();
+      current = &levels.back();
+      current->line = lineNo;
+      current->stars = stars;
+      continue;
+    }
+    if (!current) return fail(path, lineNo, "row outside a level");
+    if (text.find_first_not_of("#.SE") != std::string::npos) return fail(path, lineNo, "unknown cell");
+    current->rows.push_back(text);
+  }
+
+  for (Level &level : levels) {
+    if (level.rows.empty()) return fail(path, level.line, "level has no rows");
+    size_t width = level.rows[0].size();
+    if (width > maxDim || level.rows.size() > maxDim) return fail(path, level.line, "level is larger than 32x32");
+    if (level.stars > 255) return fail(path, level.line, "too many stars");
+    unsigned starts = 0, exits = 0;
+    for (unsigned r = 0; r < level.rows.size(); r++) {
+      if (level.rows[r].size() != width) return fail(path, level.line + 1 + r, "rows differ in width");
+      for (unsigned c = 0; c < width; c++) {
+        if (level.rows[r][c] == 'S') { level.startCol = c; level.startRow = r; starts++; }
+        if (level.rows[r][c] == 'E') { level.exitCol = c; level.exitRow = r; exits++; }
+      }
+    }
+    if (starts != 1 || exits != 1) return fail(path, level.line, "level needs exactly one S and one E");
+  }
+  return true;
+}
+
+// Top tile row in the high nibble, column 0 in each nibble's MSB
+static uint16_t cutTile(const Level &level, unsigned tileCol, unsigned tileRow) {
+  uint16_t tile = 0;
+  for (unsigned r = 0; r < tileSize; r++) {
+    for (unsigned c = 0; c < tileSize; c++) {
+      unsigned row = tileRow * tileSize + r;
+      unsigned col = tileCol * tileSize + c;
+      bool wall = row >= level.rows.size() || col >= level.rows[row].size() || level.rows[row][col] == '#';
+      tile = (uint16_t)(tile << 1 | wall);
+    }
+  }
+  return tile;
+}
+
+static bool isOpen(const Level &level, int c, int r) {
+  return r >= 0 && r < (int)level.rows.size() && c >= 0 && c < (int)level.rows[r].size() &&
+         level.rows[r][c] != '#';
+}
+
+// Breadth-first search back from the exit. Nibbles as in level_pack.h: the
+// next hop in the high two bits, the distance mod 4 in the low two, 0 for
+// walls and the exit. A nibble has no room to mark a cell cut off from the
+// exit, so every open cell must reach it.
+static bool bakePaths(const char *path, Level &level) {
+  static const int stepCol[4] = { 0, 0, -1, 1 }; // up, down, left, right
+  static const int stepRow[4] = { -1, 1, 0, 0 };
+  const int width = level.rows[0].size();
+  const int height = level.rows.size();
+  std::vector<int> dist(width * height, -1);
+  std::queue<int> frontier;
+  dist[level.exitRow * width + level.exitCol] = 0;
+  frontier.push(level.exitRow * width + level.exitCol);
+  while (!frontier.empty()) {
+    int cell = frontier.front();
+    frontier.pop();
+    for (int d = 0; d < 4; d++) {
+      int c = cell % width + stepCol[d], r = cell / width + stepRow[d];
+      if (!isOpen(level, c, r) || dist[r * width + c] >= 0) continue;
+      dist[r * width + c] = dist[cell] + 1;
+      frontier.push(r * width + c);
+    }
+  }
+  if (dist[level.startRow * width + level.startCol] < 0) return fail(path, level.line, "exit cannot be reached from the start");
+  level.exitDistance = dist[level.startRow * width + level.startCol];
+
+  const int stride = (width + 1) / 2;
+  level.paths.assign(stride * height, 0);
+  for (int r = 0; r < height; r++) {
+    for (int c = 0; c < width; c++) {
+      int here = dist[r * width + c];
+      if (here < 0 && isOpen(level, c, r)) return fail(path, level.line, "an open cell cannot reach the exit");
+      if (here <= 0) continue;
+      int hop = 0;
+      while (!(isOpen(level, c + stepCol[hop], r + stepRow[hop]) &&
+               dist[(r + stepRow[hop]) * width + c + stepCol[hop]] == here - 1)) hop++;
+      uint8_t nibble = (uint8_t)(hop << 2 | (here & 3));
+      level.paths[r * stride + c / 2] |= c & 1 ? nibble : nibble << 4;
+    }
+  }
+  return true;
+}
+
+// Storage the levels took as one PROGMEM row array each
+static unsigned rowArrayBytes(const Level &level) {
+  size_t width = level.rows[0].size();
+  unsigned word = width <= 8 ? 1 : width <= 16 ? 2 : 4;
+  return word * level.rows.size();
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s LEVELS.txt OUT.h\n", argv[0]);
+    return 1;
+  }
+  std::vector<Level> levels;
+  if (!parse(argv[1], levels)) return 1;
+  if (levels.empty()) {
+    fprintf(stderr, "%s: no levels\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<uint16_t> tiles;
+  std::map<uint16_t, uint8_t> index;
+  unsigned mapBytes = 0, rowBytes = 0, pathBytes = 0, cellCount = 0;
+  for (Level &level : levels) {
+    if (!bakePaths(argv[1], level)) return 1;
+    pathBytes += level.paths.size();
+    cellCount += level.rows.size() * level.rows[0].size();
+    unsigned tileCols = (level.rows[0].size() + tileSize - 1) / tileSize;
+    unsigned tileRows = (level.rows.size() + tileSize - 1) / tileSize;
+    for (unsigned tr = 0; tr < tileRows; tr++) {
+      for (unsigned tc = 0; tc < tileCols; tc++) {
+        uint16_t tile = cutTile(level, tc, tr);
+        auto found = index.find(tile);
+        if (found == index.end()) {
+          if (tiles.size() == maxTiles) {
+            fprintf(stderr, "%s: more than %u distinct tiles\n", argv[1], maxTiles);
+            return 1;
+          }
+          found = index.emplace(tile, (uint8_t)tiles.size()).first;
+          tiles.push_back(tile);
+        }
+        level.map.push_back(found->second);
+      }
+    }
+    mapBytes += level.map.size();
+    rowBytes += rowArrayBytes(level);
+  }
+
+  FILE *out = fopen(argv[2], "w");
+  if (!out) {
+    fprintf(stderr, "%s: cannot write\n", argv[2]);
+    return 1;
+  }
+  const char *source = strrchr(argv[1], '/');
+  source = source ? source + 1 : argv[1];
+  unsigned tileBytes = tiles.size() * 2;
+  fprintf(out, "// Generated by host/tools/level_packer from %s, do not edit.\n", source);
+  fprintf(out, "// %zu levels, %zu distinct 4x4 tiles: %u dictionary + %u map bytes\n",
+          levels.size(), tiles.size(), tileBytes, mapBytes);
+  fprintf(out, "// (%u bytes as plain row arrays), %u path table bytes packed (%u at a byte a cell).\n", rowBytes,
+          pathBytes, cellCount);
+  fprintf(out, "// Included by main.cpp after makePackedLevelDef.\n\n");
+
+  fprintf(out, "const uint16_t levelTiles[%zu] PROGMEM = {", tiles.size());
+  for (size_t i = 0; i < tiles.size(); i++) {
+    fprintf(out, "%s0x%04X%s", i % 8 ? " " : "\n  ", tiles[i], i + 1 < tiles.size() ? "," : "");
+  }
+  fprintf(out, "\n};\n\n");
+
+  for (size_t l = 0; l < levels.size(); l++) {
+    const Level &level = levels[l];
+    unsigned tileCols = (level.rows[0].size() + tileSize - 1) / tileSize;
+    fprintf(out, "const uint8_t levelMap%zu[%zu] PROGMEM = {", l + 1, level.map.size());
+    for (size_t i = 0; i < level.map.size(); i++) {
+      fprintf(out, "%s%u%s", i % tileCols ? " " : "\n  ", level.map[i], i + 1 < level.map.size() ? "," : "");
+    }
+    fprintf(out, "\n};\n\n");
+
+    // One line per level row; the distance comment shows up in level diffs
+    unsigned stride = level.paths.size() / level.rows.size();
+    fprintf(out, "// Exit %u steps from the start\nconst uint8_t levelPaths%zu[%zu] PROGMEM = {", level.exitDistance,
+            l + 1, level.paths.size());
+    for (size_t i = 0; i < level.paths.size(); i++) {
+      fprintf(out, "%s0x%02X%s", i % stride ? " " : "\n  ", level.paths[i], i + 1 < level.paths.size() ? "," : "");
+    }
+    fprintf(out, "\n};\n\n");
+  }
+
+  fprintf(out, "const LevelDef levelDefs[%zu] PROGMEM = {\n", levels.size());
+  for (size_t l = 0; l < levels.size(); l++) {
+    const Level &level = levels[l];
+    fprintf(out, "  makePackedLevelDef<%zu, %zu>(levelMap%zu, levelPaths%zu, %u, %u, %u, %u, %u)%s\n",
+            level.rows[0].size(), level.rows.size(), l + 1, l + 1, level.startCol, level.startRow,
+            level.exitCol, level.exitRow, level.stars, l + 1 < levels.size() ? "," : "");
+  }
+  fprintf(out, "};\n");
+  fclose(out);
+
+  printf("%zu levels, %zu tiles: %u dictionary + %u map = %u bytes (row arrays: %u bytes), %u packed path bytes "
+         "(%u at a byte a cell)\n",
+         levels.size(), tiles.size(), tileBytes, mapBytes, tileBytes + mapBytes, rowBytes, pathBytes, cellCount);
+  return 0;
+}
@@ -0,0 +1,318 @@
+// Replays games recorded with RECORD_INPUT (see input_recorder.h) through
+// the firmware's own rules, headless: no scheduler, display or sound, just
+// beginGame() and gameRun() per recorded run.
+//
+// Usage: replay FILE [--runs N]
+//        replay --bot [--levels N] [--seed S] [--random-mazes] [--runs N] [--save FILE]
+//
+// FILE is a Serial capture holding one or more recordings; anything around
+// them is skipped. With --bot a breadth-first bot plays N levels (default
+// 3) through handleGame() with the recorder on, quits from the pause menu,
+// and its recording is replayed and checked against the state the live game
+// ended in. Every game is then replayed --runs times (default 1000) to time
+// a replay.
+
+#define RECORD_INPUT 1
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "hal_host.h"
+#include "main.cpp"
+
+struct Recording {
+  uint32_t seed = 0;
+  uint8_t flags = 0;
+  uint32_t ticks = 0;
+  uint16_t dropped = 0;
+  std::vector<uint16_t> runs;
+};
+
+// Where a game ended up; two games with equal results played out the same
+struct GameResult {
+  uint8_t state;
+  uint16_t score;
+  uint8_t level;
+  uint8_t stars;
+  uint16_t col;
+  uint16_t row;
+  uint32_t clock;
+
+  bool operator==(const GameResult &o) const {
+    return state == o.state && score == o.score && level == o.level && stars == o.stars &&
+           col == o.col && row == o.row && clock == o.clock;
+  }
+};
+
+static GameResult currentResult() {
+  return GameResult{ (uint8_t)currentState, currentScore, currentLevelIndex, currentLevelStarsCollected,
+                     playerCol, playerRow, gameClock };
+}
+
+static void printResult(const char *label, const GameResult &r) {
+  printf("%-8s state %u, score %u, level %u, stars %u, at (%u, %u), game clock %u ms\n", label, r.state,
+         r.score, r.level + 1, r.stars, r.col, r.row, r.clock);
+}
+
+// Collects what the recorder drains, with the room of an empty Serial buffer
+class CapturePrint : public Print {
+public:
+  std::string text;
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+  int availableForWrite() override { return 63; }
+};
+
+static bool parseRecordings(const std::string &text, std::vector<Recording> &out) {
+  std::istringstream in(text);
+  std::string line;
+  Recording *current = nullptr;
+  unsigned lineNo = 0;
+  while (std::getline(in, line)) {
+    lineNo++;
+    unsigned long seed, ticks;
+    unsigned version, flags, dropped;
+    if (sscanf(line.c_str(), "REC %u %lu %u", &version, &seed, &flags) == 3) {
+      if (version != 1) {
+        fprintf(stderr, "line %u: unknown recording version %u\n", lineNo, version);
+        return false;
+      }
+      out.emplace_back();
+      current = &out.back();
+      current->seed = seed;
+      current->flags = flags;
+      continue;
+    }
+    if (!current) continue;
+    if (sscanf(line.c_str(), "END %lu %u", &ticks, &dropped) == 2) {
+      current->ticks = ticks;
+      current->dropped = dropped;
+      current = nullptr;
+      continue;
+    }
+    std::istringstream words(line);
+    std::string word;
+    while (words >> word) {
+      char *end;
+      unsigned long run = strtoul(word.c_str(), &end, 16);
+      if (word.size() != 4 || *end) {
+        fprintf(stderr, "line %u: bad run '%s'\n", lineNo, word.c_str());
+        return false;
+      }
+      current->runs.push_back((uint16_t)run);
+    }
+  }
+  if (current) {
+    fprintf(stderr, "recording cut off before its END line\n");
+    return false;
+  }
+  return true;
+}
+
+static void applyFlags(uint8_t flags) {
+  settingIMUEnabled = flags & RECORD_IMU_CONTROL;
+  imuHardwareAvailable = settingIMUEnabled;
+  settingRandomMazes = flags & RECORD_RANDOM_MAZES;
+}
+
+static void replay(const Recording &rec) {
+  applyFlags(rec.flags);
+  beginGame(rec.seed);
+  for (uint16_t run : rec.runs) gameRun(unpackTickInput(tickRunInput(run)), tickRunLength(run));
+}
+
+static double timeReplays(const Recording &rec, uint32_t runs) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < runs; i++) replay(rec);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(t1 - t0).count() / runs;
+}
+
+// Star index rows are as wide as the level's own rows
+static bool hasStar(uint8_t c, uint8_t r) {
+  if (currentLevel.width <= 8) return ((uint8_t *)currentStarRows)[r] & levelColumnMask<uint8_t>(c);
+  if (currentLevel.width <= 16) return ((uint16_t *)currentStarRows)[r] & levelColumnMask<uint16_t>(c);
+  return ((uint32_t *)currentStarRows)[r] & levelColumnMask<uint32_t>(c);
+}
+
+// First step towards the nearest star, or the exit once they are all taken
+static uint8_t botStep() {
+  static const int8_t stepCol[4] = { 0, 0, -1, 1 }; // DIR_UP .. DIR_RIGHT
+  static const int8_t stepRow[4] = { -1, 1, 0, 0 };
+  const uint8_t w = currentLevel.width, h = currentLevel.height;
+  bool wantExit = currentLevelStarsCollected >= currentLevelStarsTotal;
+  std::vector<uint8_t> firstStep(w * h, DIR_NONE);
+  std::vector<bool> seen(w * h, false);
+  std::queue<uint16_t> frontier;
+  seen[playerRow * w + playerCol] = true;
+  frontier.push(playerRow * w + playerCol);
+  while (!frontier.empty()) {
+    uint16_t cell = frontier.front();
+    frontier.pop();
+    uint8_t c = cell % w, r = cell / w;
+    bool isExit = c == currentLevel.exitCol && r == currentLevel.exitRow;
+    if (firstStep[cell] != DIR_NONE && (wantExit ? isExit : hasStar(c, r))) return firstStep[cell];
+    for (uint8_t d = 0; d < 4; d++) {
+      uint8_t nc = c + stepCol[d], nr = r + stepRow[d];
+      if (nc >= w || nr >= h || seen[nr * w + nc] || isWall(nc, nr)) continue;
+      seen[nr * w + nc] = true;
+      firstStep[nr * w + nc] = firstStep[cell] != DIR_NONE ? firstStep[cell] : d + DIR_UP;
+      frontier.push(nr * w + nc);
+    }
+  }
+  return DIR_NONE;
+}
+
+// One game tick through the firmware's handler, as updateGame() runs it
+// while the game is on
+static void botTick(int8_t joyX, int8_t joyY, bool press, CapturePrint &capture) {
+  joyXDir = joyX;
+  joyYDir = joyY;
+  btnJustPressed = press;
+  btnLongPressed = false;
+  tickNow += gameTickPeriod;
+  if (currentState == STATE_GAME_PLAYING || currentState == STATE_GAME_PAUSED) handleGame();
+  if ((tickNow / gameTickPeriod) % (recordDrainPeriod / gameTickPeriod) == 0) recorder.drain(capture);
+}
+
+static bool playBot(uint8_t levels, uint32_t seed, bool randomMazes, std::string &capture, GameResult &result) {
+  CapturePrint out;
+  settingRandomMazes = randomMazes;
+  randomSeed(seed);
+  startGame();
+
+  const uint32_t tickLimit = 600000 / gameTickPeriod; // 10 game minutes
+  uint32_t ticks = 0;
+  while (currentState == STATE_GAME_PLAYING && currentLevelIndex < levels && ticks++ < tickLimit) {
+    switch (botStep()) {
+      case DIR_UP: botTick(0, -1, false, out); break;
+      case DIR_DOWN: botTick(0, 1, false, out); break;
+      case DIR_LEFT: botTick(-1, 0, false, out); break;
+      case DIR_RIGHT: botTick(1, 0, false, out); break;
+      default:
+        fprintf(stderr, "bot is stuck on level %u\n", currentLevelIndex + 1);
+        return false;
+    }
+  }
+  if (ticks >= tickLimit) {
+    fprintf(stderr, "bot ran out of time on level %u\n", currentLevelIndex + 1);
+    return false;
+  }
+
+  // Pause, pick Exit, confirm
+  if (currentState == STATE_GAME_PLAYING) {
+    botTick(0, 0, true, out);
+    for (uint8_t i = 0; i < 20; i++) botTick(0, 0, false, out);
+    botTick(1, 0, false, out);
+    for (uint8_t i = 0; i < 20; i++) botTick(0, 0, false, out);
+    botTick(0, 0, true, out);
+  }
+  for (uint8_t i = 0; !recorder.idle() && i < 100; i++) botTick(0, 0, false, out);
+  if (!recorder.idle()) {
+    fprintf(stderr, "recording did not finish\n");
+    return false;
+  }
+  capture = out.text;
+  result = currentResult();
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *file = nullptr;
+  const char *savePath = nullptr;
+  bool bot = false;
+  bool randomMazes = false;
+  uint32_t levels = 3;
+  uint32_t seed = 1;
+  uint32_t runs = 1000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--bot")) bot = true;
+    else if (!strcmp(argv[i], "--levels") && i + 1 < argc) levels = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--random-mazes")) randomMazes = true;
+    else if (!strcmp(argv[i], "--runs") && i + 1 < argc) runs = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--save") && i + 1 < argc) savePath = argv[++i];
+    else if (argv[i][0] != '-' && !file) file = argv[i];
+    else {
+      file = nullptr;
+      bot = false;
+      break;
+    }
+  }
+  if (bot == (file != nullptr) || levels < 1 || levels > totalLevels || runs < 1) {
+    fprintf(stderr, "usage: %s FILE [--runs N]\n"
+                    "       %s --bot [--levels N] [--seed S] [--random-mazes] [--runs N] [--save FILE]\n",
+            argv[0], argv[0]);
+    return 1;
+  }
+
+  hostSetDigital(PIN_JOY_BTN, HIGH);
+  setup();
+
+  std::string text;
+  GameResult live = {};
+  if (bot) {
+    if (!playBot(levels, seed, randomMazes, text, live)) return 1;
+    if (savePath) {
+      FILE *f = fopen(savePath, "w");
+      if (!f) {
+        fprintf(stderr, "%s: cannot write\n", savePath);
+        return 1;
+      }
+      fputs(text.c_str(), f);
+      fclose(f);
+    }
+  } else {
+    FILE *f = fopen(file, "r");
+    if (!f) {
+      fprintf(stderr, "%s: cannot open\n", file);
+      return 1;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+  }
+
+  std::vector<Recording> recordings;
+  if (!parseRecordings(text, recordings)) return 1;
+  if (recordings.empty()) {
+    fprintf(stderr, "no recordings found\n");
+    return 1;
+  }
+
+  int status = 0;
+  for (size_t i = 0; i < recordings.size(); i++) {
+    const Recording &rec = recordings[i];
+    uint32_t ticks = 0;
+    for (uint16_t run : rec.runs) ticks += tickRunLength(run);
+    printf("Game %zu: seed %u, flags %u, %u ticks (%.1f s) in %zu runs\n", i + 1, rec.seed, rec.flags,
+           rec.ticks, rec.ticks * gameTickPeriod / 1000.0, rec.runs.size());
+    if (rec.dropped || ticks != rec.ticks) {
+      printf("  not replayable: %u runs dropped, %u of %u ticks recorded\n", rec.dropped, ticks, rec.ticks);
+      status = 1;
+      continue;
+    }
+
+    replay(rec);
+    GameResult replayed = currentResult();
+    printResult("  replay", replayed);
+    if (bot) {
+      printResult("  live", live);
+      if (!(replayed == live)) {
+        printf("  MISMATCH\n");
+        status = 1;
+      }
+    }
+    printf("  %.2f us per replay (%u runs)\n", timeReplays(rec, runs), runs);
+  }
+  return status;
+}
@@ -0,0 +1,746 @@
+// Plays large numbers of games with a bot and reports score and clear-time
+// distributions per level, to tune the scoring constants and star counts
+// without playing on the board.
+//
+// Usage: sim_farm [--games N] [--policy random|greedy|optimal] [--threads N]
+//                 [--seed S] [--levels N] [--random-mazes] [--stars N]
+//                 [--star-points N] [--clear-points N] [--second-penalty N]
+//                 [--time-limit S] [--check N]
+//
+// The levels are the firmware's own: the built-in level pack, or mazes
+// carved by generateMaze() with --random-mazes. Stars go on the cells the
+// firmware allows (minStartDist/minExitDist along the maze), and levels are
+// scored with levelClearBonus(). A game is simulated move by move rather
+// than through gameTick(), whose state is global: a held direction moves
+// once per moveCooldown (the first tick past it), a move into a wall costs
+// one tick. Policies:
+//
+//   random   a new random direction after every move or bump
+//   greedy   walks to the nearest star left, then to the exit
+//   optimal  the par route: shortest through all stars to the exit
+//
+// A level not cleared within --time-limit seconds (default 300) ends the
+// game.
+//
+// Since these rules are a copy, the farm first checks them against the
+// firmware (--check N, default 20, 0 to skip): N games per policy, random
+// and greedy, on the levels and stars beginGame() lays out, go through
+// gameTick() one attempted direction at a time. The stars, the outcome, the
+// level score and the clear time must come out the same, and every star
+// must be on a cell the farm would have picked from.
+//
+// Games are cut into chunks that worker threads take from their own
+// queues and steal from each other's; every chunk seeds its own RNG stream
+// from (seed, chunk), so the results do not depend on the thread count.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hal_host.h"
+#include "main.cpp"
+
+enum Policy { POLICY_RANDOM, POLICY_GREEDY, POLICY_OPTIMAL };
+static const char *policyNames[] = { "random", "greedy", "optimal" };
+
+struct SimOptions {
+  Policy policy = POLICY_GREEDY;
+  uint32_t games = 100000;
+  uint32_t threads = 0;
+  uint64_t seed = 1;
+  uint8_t levels = totalLevels;
+  bool randomMazes = false;
+  int stars = -1; // -1: each level's own count
+  uint16_t starPoints = pointsPerStar;
+  uint16_t clearPoints = baseLevelClearPoints;
+  uint16_t secondPenalty = timeBonusDeduction;
+  uint32_t timeLimitMs = 300000;
+  uint32_t checkGames = 20;
+};
+
+static SimOptions options;
+
+// Ticks from one move to the next with the direction held
+static const uint32_t moveTicks = moveRepeatMillis / gameTickPeriod;
+static const uint32_t moveMillis = moveRepeatMillis;
+static const uint32_t timeBucketMs = 100;
+static const uint16_t unreached = 0xFFFF;
+
+// SplitMix64: cheap, and any seed gives an independent looking stream
+struct SimRng {
+  uint64_t state = 0;
+
+  void seed(uint64_t s) { state = s; }
+  uint64_t next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+  // [0, n), the interface generateMaze() and RandomRange share
+  uint16_t operator()(uint16_t n) { return (uint16_t)((next() >> 32) % n); }
+};
+
+// Breadth-first distances over a grid of open cells, unreached elsewhere
+static void gridDistances(const uint8_t *open, uint8_t width, uint8_t height, uint16_t from,
+                          uint16_t *dist, uint16_t *queue) {
+  const uint16_t cells = width * height;
+  for (uint16_t i = 0; i < cells; i++) dist[i] = unreached;
+  uint16_t head = 0, tail = 0;
+  dist[from] = 0;
+  queue[tail++] = from;
+  while (head < tail) {
+    uint16_t cell = queue[head++];
+    uint8_t c = cell % width, r = cell / width;
+    uint16_t next[4];
+    uint8_t n = 0;
+    if (r > 0) next[n++] = cell - width;
+    if (r + 1 < height) next[n++] = cell + width;
+    if (c > 0) next[n++] = cell - 1;
+    if (c + 1 < width) next[n++] = cell + 1;
+    for (uint8_t i = 0; i < n; i++) {
+      if (!open[next[i]] || dist[next[i]] != unreached) continue;
+      dist[next[i]] = dist[cell] + 1;
+      queue[tail++] = next[i];
+    }
+  }
+}
+
+// Cells the firmware may put a star on (see placeStarsIn)
+static void starCandidates(const uint8_t *open, uint16_t cells, const uint16_t *fromStart,
+                           const uint16_t *fromExit, std::vector<uint16_t> &out) {
+  out.clear();
+  for (uint16_t i = 0; i < cells; i++) {
+    if (open[i] && fromStart[i] != unreached && fromStart[i] >= minStartDist &&
+        fromExit[i] != unreached && fromExit[i] >= minExitDist) {
+      out.push_back(i);
+    }
+  }
+}
+
+struct SimLevel {
+  uint8_t width, height;
+  uint8_t startCol, startRow, exitCol, exitRow;
+  uint8_t starCount;
+  bool generated;
+  // Built-in levels never change, so these are worked out once and shared
+  std::vector<uint8_t> open;       // 1 per open cell
+  std::vector<uint16_t> distances; // All pairs, cells x cells
+  std::vector<uint16_t> candidates;
+};
+
+static std::vector<SimLevel> simLevels;
+
+static void loadLevels() {
+  const LevelDef *defs = options.randomMazes ? generatedLevelDefs : levelDefs;
+  for (uint8_t i = 0; i < options.levels; i++) {
+    LevelDef def;
+    memcpy_P(&def, &defs[i], sizeof(LevelDef));
+    SimLevel level;
+    level.width = def.width;
+    level.height = def.height;
+    level.startCol = def.startCol;
+    level.startRow = def.startRow;
+    level.exitCol = def.exitCol;
+    level.exitRow = def.exitRow;
+    level.starCount = options.stars >= 0 ? options.stars : def.starCount;
+    level.generated = def.generate != nullptr;
+    if (!level.generated) {
+      const uint16_t cells = def.width * def.height;
+      level.open.resize(cells);
+      for (uint16_t c = 0; c < cells; c++) {
+        level.open[c] = !TiledRows::cell<uint32_t>(def.rows, def.width, c % def.width, c / def.width);
+      }
+      level.distances.resize(cells * cells);
+      std::vector<uint16_t> queue(cells);
+      for (uint16_t from = 0; from < cells; from++) {
+        gridDistances(level.open.data(), def.width, def.height, from, &level.distances[from * cells], queue.data());
+      }
+      starCandidates(level.open.data(), cells, &level.distances[(def.startRow * def.width + def.startCol) * cells],
+                     &level.distances[(def.exitRow * def.width + def.exitCol) * cells], level.candidates);
+    }
+    simLevels.push_back(level);
+  }
+}
+
+struct LevelOutcome {
+  bool cleared;
+  uint8_t stars; // collected
+  uint32_t millis;
+  uint32_t points;
+};
+
+// Per-thread scratch. Distances are only ever needed from the start, the
+// exit and the stars (the bots walk from one to the next); built-in levels
+// look them up, generated ones search from each of them.
+class LevelSim {
+public:
+  LevelSim()
+    : rows(maxLevelDim), stack(mazeStackBytes(maxLevelDim, maxLevelDim)), carved(maxLevelDim * maxLevelDim),
+      queue(maxLevelDim * maxLevelDim), starAt(maxLevelDim * maxLevelDim) {}
+
+  LevelOutcome play(const SimLevel &level, SimRng &rng) {
+    width = level.width;
+    height = level.height;
+    cells = width * height;
+    start = level.startRow * width + level.startCol;
+    exit = level.exitRow * width + level.exitCol;
+    if (level.generated) {
+      carve(level, rng);
+      searched.resize((2 + level.starCount) * cells); // Rows are handed out as pointers
+      distStart = search(0, start);
+      distExit = search(1, exit);
+      starCandidates(open, cells, distStart, distExit, candidates);
+      placeStars(level.starCount, candidates, rng);
+      for (uint8_t i = 0; i < stars.size(); i++) distStar[i] = search(2 + i, stars[i]);
+    } else {
+      open = level.open.data();
+      distStart = &level.distances[start * cells];
+      distExit = &level.distances[exit * cells];
+      placeStars(level.starCount, level.candidates, rng);
+      for (uint8_t i = 0; i < stars.size(); i++) distStar[i] = &level.distances[stars[i] * cells];
+    }
+
+    return run(options.policy, rng);
+  }
+
+  // A layout from elsewhere (the firmware, for checkFirmware()). Every
+  // direction the policy tries, bumps included, goes on trace: 0 up,
+  // 1 down, 2 left, 3 right.
+  LevelOutcome playLayout(const uint8_t *cellsOpen, uint8_t w, uint8_t h, uint16_t startCell, uint16_t exitCell,
+                          const std::vector<uint16_t> &placed, Policy policy, SimRng &rng,
+                          std::vector<uint8_t> *directions) {
+    width = w;
+    height = h;
+    cells = w * h;
+    start = startCell;
+    exit = exitCell;
+    open = cellsOpen;
+    searched.resize((2 + placed.size()) * cells);
+    distStart = search(0, start);
+    distExit = search(1, exit);
+    stars = placed;
+    for (uint16_t s : stars) starAt[s] = 1;
+    distStar.resize(stars.size());
+    for (uint8_t i = 0; i < stars.size(); i++) distStar[i] = search(2 + i, stars[i]);
+    trace = directions;
+    LevelOutcome outcome = run(policy, rng);
+    trace = nullptr;
+    return outcome;
+  }
+
+  const uint16_t *startDistances() const { return distStart; }
+  const uint16_t *exitDistances() const { return distExit; }
+
+private:
+  LevelOutcome run(Policy policy, SimRng &rng) {
+    LevelOutcome outcome = {};
+    switch (policy) {
+      case POLICY_RANDOM: outcome = playRandom(rng); break;
+      case POLICY_GREEDY: outcome = playGreedy(); break;
+      case POLICY_OPTIMAL: outcome = playOptimal(); break;
+    }
+    for (uint16_t s : stars) starAt[s] = 0;
+    if (outcome.millis > options.timeLimitMs) {
+      outcome.cleared = false;
+      outcome.millis = options.timeLimitMs;
+    }
+    outcome.points = outcome.stars * options.starPoints;
+    if (outcome.cleared) outcome.points += levelClearBonus(outcome.millis, options.clearPoints, options.secondPenalty);
+    return outcome;
+  }
+
+  void carve(const SimLevel &level, SimRng &rng) {
+    generateMaze<uint32_t>(rows.data(), 1, level.width, level.height, stack.data(), stack.size(), rng);
+    for (uint16_t i = 0; i < cells; i++) carved[i] = !mazeIsWall<uint32_t>(rows.data(), 1, i % width, i / width);
+    open = carved.data();
+  }
+
+  const uint16_t *search(uint16_t slot, uint16_t from) {
+    uint16_t *dist = &searched[slot * cells];
+    gridDistances(open, width, height, from, dist, queue.data());
+    return dist;
+  }
+
+  // Uniform without replacement: rejection while the pick is sparse
+  void placeStars(uint8_t count, const std::vector<uint16_t> &from, SimRng &rng) {
+    stars.clear();
+    if (count >= from.size()) {
+      stars.assign(from.begin(), from.end());
+    } else if (count * 2 <= from.size()) {
+      while (stars.size() < count) {
+        uint16_t cell = from[rng(from.size())];
+        if (!starAt[cell]) {
+          starAt[cell] = 1;
+          stars.push_back(cell);
+        }
+      }
+    } else {
+      shuffled = from;
+      for (uint8_t i = 0; i < count; i++) {
+        std::swap(shuffled[i], shuffled[i + rng(shuffled.size() - i)]);
+        stars.push_back(shuffled[i]);
+      }
+    }
+    for (uint16_t s : stars) starAt[s] = 1;
+    distStar.resize(stars.size());
+  }
+
+  LevelOutcome playRandom(SimRng &rng) {
+    LevelOutcome outcome = {};
+    uint16_t at = start;
+    uint32_t ticks = 0;
+    uint8_t left = stars.size();
+    const uint32_t tickLimit = options.timeLimitMs / gameTickPeriod;
+    while (ticks <= tickLimit) {
+      ticks += moveTicks;
+      // Bumps into walls until a direction is open, one tick each
+      while (true) {
+        uint8_t c = at % width, r = at / width;
+        uint16_t to;
+        uint8_t dir = rng(4);
+        if (trace) trace->push_back(dir);
+        switch (dir) {
+          case 0: to = r > 0 ? at - width : cells; break;
+          case 1: to = r + 1 < height ? at + width : cells; break;
+          case 2: to = c > 0 ? at - 1 : cells; break;
+          default: to = c + 1 < width ? at + 1 : cells; break;
+        }
+        if (to < cells && open[to]) {
+          at = to;
+          break;
+        }
+        ticks++;
+      }
+      if (starAt[at]) {
+        starAt[at] = 0;
+        outcome.stars++;
+        left--;
+      }
+      if (at == exit && left == 0) {
+        outcome.cleared = true;
+        break;
+      }
+    }
+    outcome.millis = ticks * gameTickPeriod;
+    return outcome;
+  }
+
+  // Walks the real path so stars passed on the way are taken too
+  LevelOutcome playGreedy() {
+    LevelOutcome outcome = {};
+    uint16_t at = start;
+    const uint16_t *fromHere = distStart;
+    uint32_t moves = 0;
+    uint8_t left = stars.size();
+    while (true) {
+      const uint16_t *toTarget = distExit;
+      uint16_t target = exit;
+      if (left > 0) {
+        uint16_t nearest = unreached;
+        for (uint8_t i = 0; i < stars.size(); i++) {
+          if (starAt[stars[i]] && fromHere[stars[i]] < nearest) {
+            nearest = fromHere[stars[i]];
+            target = stars[i];
+            toTarget = distStar[i];
+          }
+        }
+      }
+      if (toTarget[at] == unreached) return outcome;
+      fromHere = toTarget;
+      while (at != target) {
+        uint8_t c = at % width;
+        uint8_t dir;
+        if (at >= width && toTarget[at - width] + 1 == toTarget[at]) at -= width, dir = 0;
+        else if (at + width < cells && toTarget[at + width] + 1 == toTarget[at]) at += width, dir = 1;
+        else if (c > 0 && toTarget[at - 1] + 1 == toTarget[at]) at -= 1, dir = 2;
+        else at += 1, dir = 3;
+        if (trace) trace->push_back(dir);
+        moves++;
+        if (starAt[at]) {
+          starAt[at] = 0;
+          outcome.stars++;
+          left--;
+        }
+        if (at == exit && left == 0) {
+          outcome.cleared = true;
+          outcome.millis = moves * moveMillis;
+          return outcome;
+        }
+      }
+    }
+  }
+
+  // The firmware's par route (route_solver.h), by Held-Karp
+  LevelOutcome playOptimal() {
+    const uint8_t k = stars.size();
+    route.resize(routeDistanceCount(k + 2));
+    for (uint8_t i = 0; i < k; i++) {
+      route[routePairIndex(0, i + 1)] = distStart[stars[i]];
+      route[routePairIndex(i + 1, k + 1)] = distExit[stars[i]];
+      for (uint8_t j = 0; j < i; j++) route[routePairIndex(i + 1, j + 1)] = distStar[i][stars[j]];
+    }
+    route[routePairIndex(0, k + 1)] = distStart[exit];
+    table.resize((1u << k) * k);
+
+    LevelOutcome outcome = {};
+    outcome.stars = k;
+    outcome.cleared = true;
+    outcome.millis = routeHeldKarp(route.data(), k, table.data()) * moveMillis;
+    return outcome;
+  }
+
+  uint8_t width = 0, height = 0;
+  uint16_t cells = 0;
+  uint16_t start = 0, exit = 0;
+  const uint8_t *open = nullptr;
+  const uint16_t *distStart = nullptr;
+  const uint16_t *distExit = nullptr;
+  std::vector<const uint16_t *> distStar;
+  std::vector<uint32_t> rows;
+  std::vector<uint8_t> stack;
+  std::vector<uint8_t> carved;
+  std::vector<uint16_t> queue;
+  std::vector<uint16_t> searched; // Generated levels' distance rows
+  std::vector<uint8_t> starAt;
+  std::vector<uint16_t> stars;
+  std::vector<uint16_t> candidates;
+  std::vector<uint16_t> shuffled;
+  std::vector<uint16_t> route;
+  std::vector<uint16_t> table;
+  std::vector<uint8_t> *trace = nullptr;
+};
+
+// Score and clear-time histograms for one level, or the whole game
+struct Distribution {
+  uint64_t played = 0;
+  uint64_t cleared = 0;
+  std::vector<uint64_t> points;  // by score
+  std::vector<uint64_t> clearMs; // cleared levels only, timeBucketMs buckets
+
+  void init(uint32_t maxPoints, uint32_t maxMs) {
+    points.assign(maxPoints + 1, 0);
+    clearMs.assign(maxMs / timeBucketMs + 1, 0);
+  }
+  void add(const Distribution &o) {
+    played += o.played;
+    cleared += o.cleared;
+    for (size_t i = 0; i < points.size(); i++) points[i] += o.points[i];
+    for (size_t i = 0; i < clearMs.size(); i++) clearMs[i] += o.clearMs[i];
+  }
+};
+
+struct Chunk {
+  uint32_t index;
+  uint32_t firstGame;
+  uint32_t games;
+};
+
+// A worker's own chunks: it pops from the back, thieves take the front
+class ChunkQueue {
+public:
+  void push(const Chunk &chunk) {
+    std::lock_guard<std::mutex> lock(mutex);
+    chunks.push_back(chunk);
+  }
+  bool pop(Chunk &chunk) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chunks.empty()) return false;
+    chunk = chunks.back();
+    chunks.pop_back();
+    return true;
+  }
+  bool steal(Chunk &chunk) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (chunks.empty()) return false;
+    chunk = chunks.front();
+    chunks.pop_front();
+    return true;
+  }
+
+private:
+  std::mutex mutex;
+  std::deque<Chunk> chunks;
+};
+
+struct Worker {
+  std::vector<Distribution> levels; // per level, then the whole game last
+  uint32_t chunksStolen = 0;
+};
+
+static uint32_t maxLevelPoints(const SimLevel &level) {
+  return level.starCount * options.starPoints + options.clearPoints;
+}
+
+static void runWorker(uint32_t self, std::vector<ChunkQueue> &queues, Worker &worker) {
+  uint32_t gamePoints = 0;
+  for (const SimLevel &level : simLevels) gamePoints += maxLevelPoints(level);
+  worker.levels.resize(simLevels.size() + 1);
+  for (size_t i = 0; i < simLevels.size(); i++) worker.levels[i].init(maxLevelPoints(simLevels[i]), options.timeLimitMs);
+  worker.levels.back().init(gamePoints, options.timeLimitMs * simLevels.size());
+
+  LevelSim sim;
+  SimRng rng;
+  Chunk chunk;
+  while (true) {
+    bool found = queues[self].pop(chunk);
+    for (uint32_t i = 1; !found && i < queues.size(); i++) {
+      found = queues[(self + i) % queues.size()].steal(chunk);
+      if (found) worker.chunksStolen++;
+    }
+    if (!found) return; // No chunks are added once the workers start
+
+    rng.seed(options.seed * 0x2545F4914F6CDD1Dull + chunk.index);
+    for (uint32_t g = 0; g < chunk.games; g++) {
+      uint32_t total = 0, totalMs = 0;
+      bool clearedAll = true;
+      for (size_t l = 0; l < simLevels.size(); l++) {
+        LevelOutcome outcome = sim.play(simLevels[l], rng);
+        Distribution &d = worker.levels[l];
+        d.played++;
+        d.points[outcome.points]++;
+        total += outcome.points;
+        totalMs += outcome.millis;
+        if (!outcome.cleared) {
+          clearedAll = false;
+          break;
+        }
+        d.cleared++;
+        d.clearMs[outcome.millis / timeBucketMs]++;
+      }
+      Distribution &game = worker.levels.back();
+      game.played++;
+      game.points[total]++;
+      if (clearedAll) {
+        game.cleared++;
+        game.clearMs[totalMs / timeBucketMs]++;
+      }
+    }
+  }
+}
+
+// The level beginGame()/initLevels() just set up, as the farm sees one
+struct FirmwareLevel {
+  uint8_t width, height;
+  uint16_t start, exit;
+  std::vector<uint8_t> open;
+  std::vector<uint16_t> stars;
+};
+
+static void readFirmwareLevel(FirmwareLevel &level) {
+  level.width = currentLevel.width;
+  level.height = currentLevel.height;
+  level.start = currentLevel.startRow * level.width + currentLevel.startCol;
+  level.exit = currentLevel.exitRow * level.width + currentLevel.exitCol;
+  level.open.resize(level.width * level.height);
+  level.stars.clear();
+  // takeStar() is the only way to read the star index, so it is put back
+  uint8_t starRows[sizeof(currentStarRows)];
+  memcpy(starRows, currentStarRows, sizeof(starRows));
+  for (uint16_t i = 0; i < level.open.size(); i++) {
+    uint8_t c = i % level.width, r = i / level.width;
+    level.open[i] = !currentLevel.isWall(c, r);
+    if (currentLevel.takeStar(c, r)) level.stars.push_back(i);
+  }
+  memcpy(currentStarRows, starRows, sizeof(starRows));
+}
+
+// One attempted direction: held until the tick that may move, which moves
+// or bumps
+static uint8_t firmwareAttempt(uint8_t dir) {
+  static const int8_t joyX[4] = { 0, 0, -1, 1 };
+  static const int8_t joyY[4] = { -1, 1, 0, 0 };
+  TickInput in = { joyX[dir], joyY[dir], 0, 0, BUTTON_NONE };
+  uint8_t events = 0;
+  while (currentState == STATE_GAME_PLAYING) {
+    bool mayMove = gameClock + gameTickPeriod - lastGameMoveTime > moveCooldown;
+    events |= gameTick(in);
+    if (mayMove) break;
+  }
+  return events;
+}
+
+// Plays `games` games per policy through both the farm and gameTick(); see
+// the top of the file. Returns the number of levels that disagreed.
+static uint32_t checkFirmware(uint32_t games) {
+  static const Policy policies[] = { POLICY_RANDOM, POLICY_GREEDY };
+  settingRandomMazes = options.randomMazes;
+  settingIMUEnabled = false;
+  LevelSim sim;
+  SimRng rng;
+  FirmwareLevel level;
+  std::vector<uint8_t> directions;
+  std::vector<uint16_t> dist(maxLevelDim * maxLevelDim), queue(maxLevelDim * maxLevelDim), candidates;
+  uint32_t levels = 0, failures = 0;
+  for (Policy policy : policies) {
+    rng.seed(options.seed * 0x9E3779B97F4A7C15ull + policy);
+    for (uint32_t g = 0; g < games; g++) {
+      beginGame(1 + rng(0x7FFF) * 0x10000ul + rng(0xFFFF));
+      for (uint8_t l = 0; l < options.levels && currentState == STATE_GAME_PLAYING; l++) {
+        readFirmwareLevel(level);
+        directions.clear();
+        LevelOutcome outcome = sim.playLayout(level.open.data(), level.width, level.height, level.start, level.exit,
+                                              level.stars, policy, rng, &directions);
+        levels++;
+
+        const char *problem = nullptr;
+        starCandidates(level.open.data(), level.open.size(), sim.startDistances(), sim.exitDistances(), candidates);
+        for (uint16_t s : level.stars) {
+          if (std::find(candidates.begin(), candidates.end(), s) == candidates.end()) problem = "star placement";
+        }
+
+        uint32_t clearBefore = gameClearMillis;
+        uint8_t events = 0;
+        for (uint8_t dir : directions) events |= firmwareAttempt(dir);
+        bool cleared = (events & EVENT_LEVEL_CLEAR) != 0;
+        uint8_t collected = cleared ? outcome.stars : currentLevelStarsCollected;
+        if (outcome.millis >= options.timeLimitMs && !outcome.cleared) {
+          // The farm stopped at its time limit; only the stars so far count
+          if (cleared || collected != outcome.stars) problem = "stars before the time limit";
+        } else if (cleared != outcome.cleared || collected != outcome.stars) {
+          problem = "stars or clear";
+        } else if (cleared && gameClearMillis - clearBefore != outcome.millis) {
+          problem = "clear time";
+        } else if (cleared && levelScores[l] != outcome.stars * pointsPerStar + levelClearBonus(outcome.millis)) {
+          problem = "score";
+        }
+        if (problem) {
+          failures++;
+          fprintf(stderr, "check: %s policy, level %u: %s differs (farm %u stars, %u ms, cleared %d)\n",
+                  policyNames[policy], l + 1, problem, outcome.stars, outcome.millis, outcome.cleared);
+        }
+        if (!outcome.cleared || problem) break;
+      }
+    }
+  }
+  printf("Checked the farm's rules against gameTick() on %u levels: %s\n", levels,
+         failures ? "MISMATCH" : "same stars, scores and clear times");
+  return failures;
+}
+
+// Value at the given fraction of a histogram's samples
+static uint32_t percentile(const std::vector<uint64_t> &histogram, uint64_t samples, double fraction) {
+  uint64_t wanted = (uint64_t)(fraction * (samples - 1));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < histogram.size(); i++) {
+    seen += histogram[i];
+    if (seen > wanted) return i;
+  }
+  return histogram.size() - 1;
+}
+
+static double mean(const std::vector<uint64_t> &histogram, uint64_t samples) {
+  double sum = 0;
+  for (size_t i = 0; i < histogram.size(); i++) sum += (double)i * histogram[i];
+  return samples ? sum / samples : 0;
+}
+
+static void printDistribution(const char *label, const char *size, int stars, const Distribution &d) {
+  if (!d.played) {
+    printf("%-6s %-6s %5s   not reached\n", label, size, stars >= 0 ? std::to_string(stars).c_str() : "");
+    return;
+  }
+  printf("%-6s %-6s %5s %8.1f%% %8.0f %6u %6u %6u %6u |", label, size,
+         stars >= 0 ? std::to_string(stars).c_str() : "", d.played ? 100.0 * d.cleared / d.played : 0.0,
+         mean(d.points, d.played), percentile(d.points, d.played, 0.1), percentile(d.points, d.played, 0.5),
+         percentile(d.points, d.played, 0.9), percentile(d.points, d.played, 1.0));
+  if (!d.cleared) {
+    printf("\n");
+    return;
+  }
+  const double bucketS = timeBucketMs / 1000.0;
+  printf(" %7.1f %6.1f %6.1f %6.1f %6.1f\n", mean(d.clearMs, d.cleared) * bucketS,
+         percentile(d.clearMs, d.cleared, 0.1) * bucketS, percentile(d.clearMs, d.cleared, 0.5) * bucketS,
+         percentile(d.clearMs, d.cleared, 0.9) * bucketS, percentile(d.clearMs, d.cleared, 1.0) * bucketS);
+}
+
+static bool parseOptions(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(arg, "--random-mazes")) {
+      options.randomMazes = true;
+      continue;
+    }
+    if (!value) return false;
+    i++;
+    if (!strcmp(arg, "--policy")) {
+      if (!strcmp(value, "random")) options.policy = POLICY_RANDOM;
+      else if (!strcmp(value, "greedy")) options.policy = POLICY_GREEDY;
+      else if (!strcmp(value, "optimal")) options.policy = POLICY_OPTIMAL;
+      else return false;
+    }
+    else if (!strcmp(arg, "--games")) options.games = strtoul(value, nullptr, 10);
+    else if (!strcmp(arg, "--threads")) options.threads = strtoul(value, nullptr, 10);
+    else if (!strcmp(arg, "--seed")) options.seed = strtoull(value, nullptr, 10);
+    else if (!strcmp(arg, "--levels")) options.levels = strtoul(value, nullptr, 10);
+    else if (!strcmp(arg, "--stars")) options.stars = atoi(value);
+    else if (!strcmp(arg, "--star-points")) options.starPoints = strtoul(value, nullptr, 10);
+    else if (!strcmp(arg, "--clear-points")) options.clearPoints = strtoul(value, nullptr, 10);
+    else if (!strcmp(arg, "--second-penalty")) options.secondPenalty = strtoul(value, nullptr, 10);
+    else if (!strcmp(arg, "--time-limit")) options.timeLimitMs = strtoul(value, nullptr, 10) * 1000;
+    else if (!strcmp(arg, "--check")) options.checkGames = strtoul(value, nullptr, 10);
+    else return false;
+  }
+  if (options.policy == POLICY_OPTIMAL && options.stars > routeMaxStars) return false;
+  return options.games > 0 && options.levels >= 1 && options.levels <= totalLevels && options.stars <= 255 &&
+         options.timeLimitMs > 0;
+}
+
+int main(int argc, char **argv) {
+  if (!parseOptions(argc, argv)) {
+    fprintf(stderr, "usage: %s [--games N] [--policy random|greedy|optimal] [--threads N] [--seed S]\n"
+                    "       [--levels N] [--random-mazes] [--stars N] [--star-points N]\n"
+                    "       [--clear-points N] [--second-penalty N] [--time-limit S] [--check N]\n", argv[0]);
+    return 1;
+  }
+  if (options.checkGames && checkFirmware(options.checkGames)) return 1;
+  loadLevels();
+
+  uint32_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  // Small enough that stealing evens out the slow chunks at the end; fixed,
+  // since a chunk's games come from its own RNG stream
+  const uint32_t chunkGames = 256;
+  std::vector<ChunkQueue> queues(threads);
+  uint32_t chunkCount = 0;
+  for (uint32_t first = 0; first < options.games; first += chunkGames, chunkCount++) {
+    queues[chunkCount % threads].push(Chunk{ chunkCount, first, std::min(chunkGames, options.games - first) });
+  }
+
+  std::vector<Worker> workers(threads);
+  std::vector<std::thread> pool;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < threads; i++) pool.emplace_back(runWorker, i, std::ref(queues), std::ref(workers[i]));
+  for (std::thread &t : pool) t.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  std::vector<Distribution> totals = workers[0].levels;
+  uint32_t stolen = workers[0].chunksStolen;
+  for (uint32_t i = 1; i < threads; i++) {
+    for (size_t l = 0; l < totals.size(); l++) totals[l].add(workers[i].levels[l]);
+    stolen += workers[i].chunksStolen;
+  }
+
+  printf("%s policy, %u games of %u %s levels on %u threads: %.2f s, %.0f games/s (%u of %u chunks stolen)\n",
+         policyNames[options.policy], options.games, options.levels, options.randomMazes ? "generated" : "built-in",
+         threads, seconds, options.games / seconds, stolen, chunkCount);
+  printf("Scoring: %u per star, %u per clear less %u per second, %.1f s limit per level\n\n", options.starPoints,
+         options.clearPoints, options.secondPenalty, options.timeLimitMs / 1000.0);
+  printf("%-6s %-6s %5s %9s %8s %6s %6s %6s %6s | %7s %6s %6s %6s %6s\n", "level", "size", "stars", "cleared",
+         "score", "p10", "p50", "p90", "max", "clear s", "p10", "p50", "p90", "max");
+  for (size_t l = 0; l < simLevels.size(); l++) {
+    char label[24], size[16];
+    snprintf(label, sizeof(label), "%zu", l + 1);
+    snprintf(size, sizeof(size), "%ux%u", simLevels[l].width, simLevels[l].height);
+    printDistribution(label, size, simLevels[l].starCount, totals[l]);
+  }
+  printDistribution("game", "", -1, totals.back());
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include "input_recorder.h"
+
+// Longest header or footer line, with the newline ending the last run line
+static const uint8_t lineRoom = 24;
+static const uint8_t runRoom = 5;
+static const uint8_t runsPerLine = 8;
+
+static uint8_t packAxis(int8_t v) { return (uint8_t)v & 0x03; }
+static int8_t unpackAxis(uint16_t bits) { return (int8_t)((uint8_t)(bits << 6)) >> 6; }
+
+uint16_t packTickInput(const TickInput &in) {
+  return packAxis(in.joyX) | packAxis(in.joyY) << 2 | packAxis(in.tiltCol) << 4 |
+         packAxis(in.tiltRow) << 6 | (uint16_t)(in.button & 0x03) << 8;
+}
+
+TickInput unpackTickInput(uint16_t bits) {
+  TickInput in;
+  in.joyX = unpackAxis(bits & 0x03);
+  in.joyY = unpackAxis(bits >> 2 & 0x03);
+  in.tiltCol = unpackAxis(bits >> 4 & 0x03);
+  in.tiltRow = unpackAxis(bits >> 6 & 0x03);
+  in.button = bits >> 8 & 0x03;
+  return in;
+}
+
+InputRecorder::InputRecorder()
+  : head(0), count(0), column(0), current(0), currentLength(0), runOpen(false), active(false),
+    headerPending(false), footerPending(false), flagBits(0), seedValue(0), tickCount(0), droppedRuns(0) {
+}
+
+void InputRecorder::begin(uint32_t seed, uint8_t flags) {
+  head = 0;
+  count = 0;
+  column = 0;
+  runOpen = false;
+  active = true;
+  headerPending = true;
+  footerPending = false;
+  flagBits = flags;
+  seedValue = seed;
+  tickCount = 0;
+  droppedRuns = 0;
+}
+
+void InputRecorder::record(const TickInput &in) {
+  if (!active) return;
+  tickCount++;
+  uint16_t bits = packTickInput(in);
+  if (runOpen && bits == current && currentLength < tickRunMax) {
+    currentLength++;
+    return;
+  }
+  if (runOpen) closeRun();
+  current = bits;
+  currentLength = 1;
+  runOpen = true;
+}
+
+void InputRecorder::closeRun() {
+  runOpen = false;
+  if (count == capacity) {
+    droppedRuns++;
+    return;
+  }
+  runs[head] = tickRunWord(current, currentLength);
+  head = (head + 1) % capacity;
+  count++;
+}
+
+void InputRecorder::end() {
+  if (!active) return;
+  if (runOpen) closeRun();
+  active = false;
+  footerPending = true;
+}
+
+void InputRecorder::drain(Print &out) {
+  if (headerPending) {
+    if (out.availableForWrite() < lineRoom) return;
+    out.print(F("REC 1 "));
+    out.print(seedValue);
+    out.print(' ');
+    out.print(flagBits);
+    out.print('\n');
+    headerPending = false;
+  }
+
+  while (count > 0 && out.availableForWrite() >= runRoom) {
+    uint16_t run = runs[(head + capacity - count) % capacity];
+    count--;
+    for (int8_t shift = 12; shift >= 0; shift -= 4) out.print("0123456789ABCDEF"[(run >> shift) & 0x0F]);
+    column = (column + 1) % runsPerLine;
+    out.print(column ? ' ' : '\n');
+  }
+
+  if (footerPending && count == 0 && out.availableForWrite() >= lineRoom) {
+    if (column) out.print('\n');
+    column = 0;
+    out.print(F("END "));
+    out.print(tickCount);
+    out.print(' ');
+    out.print(droppedRuns);
+    out.print('\n');
+    footerPending = false;
+  }
+}
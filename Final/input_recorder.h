@@ -0,0 +1,86 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <Arduino.h>
+#include "button_input.h"
+
+// One game tick of input as the game rules see it (see gameTick() in
+// main.cpp): joystick zones and IMU direction after classification, and the
+// button edge handed out this tick.
+struct TickInput {
+  int8_t joyX;    // -1/0/1 per axis
+  int8_t joyY;
+  int8_t tiltCol;
+  int8_t tiltRow;
+  uint8_t button; // BUTTON_NONE, BUTTON_PRESS or BUTTON_LONG_PRESS
+};
+
+// 10-bit form: two bits per axis (two's complement) from bit 0, the button
+// event in bits 8-9
+uint16_t packTickInput(const TickInput &in);
+TickInput unpackTickInput(uint16_t bits);
+
+// A run of identical ticks: packed input in the low 10 bits, run length - 1
+// in the top 6
+const uint8_t tickInputBits = 10;
+const uint8_t tickRunMax = 64;
+
+inline uint16_t tickRunWord(uint16_t input, uint8_t length) {
+  return input | (uint16_t)(length - 1) << tickInputBits;
+}
+inline uint16_t tickRunInput(uint16_t run) { return run & ((1u << tickInputBits) - 1); }
+inline uint8_t tickRunLength(uint16_t run) { return (run >> tickInputBits) + 1; }
+
+// Recording flags (how the rules read the input)
+const uint8_t RECORD_IMU_CONTROL = 0x01;
+const uint8_t RECORD_RANDOM_MAZES = 0x02;
+
+// Records a game as its RNG seed plus the run-length coded stream of tick
+// inputs, and streams it out as text whenever the output has room, so a
+// whole game needs only a few dozen bytes of RAM at a time:
+//
+//   REC 1 <seed> <flags>
+//   <run> <run> ...      four hex digits each, eight to a line
+//   END <ticks> <dropped runs>
+//
+// Runs that find the ring full are dropped and counted; a recording with
+// dropped runs cannot be replayed.
+class InputRecorder {
+public:
+  static const uint8_t capacity = 32; // runs
+
+  InputRecorder();
+
+  // Starts a recording, discarding whatever of the last one was not sent
+  void begin(uint32_t seed, uint8_t flags);
+  void record(const TickInput &in);
+  void end();
+
+  // Writes as much as out.availableForWrite() takes without blocking
+  void drain(Print &out);
+
+  bool recording() const { return active; }
+  bool idle() const { return !headerPending && count == 0 && !footerPending && !runOpen; }
+  uint32_t ticks() const { return tickCount; }
+  uint16_t dropped() const { return droppedRuns; }
+
+private:
+  void closeRun();
+
+  uint16_t runs[capacity];
+  uint8_t head;
+  uint8_t count;
+  uint8_t column; // runs on the current output line
+  uint16_t current;
+  uint8_t currentLength;
+  bool runOpen;
+  bool active;
+  bool headerPending;
+  bool footerPending;
+  uint8_t flagBits;
+  uint32_t seedValue;
+  uint32_t tickCount;
+  uint16_t droppedRuns;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "joystick_adc.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+static JoystickAdc *adcOwner = nullptr;
+
+static uint8_t adcMux(uint8_t pin) {
+  // AVcc reference, channel from A0..A7 or a bare channel number
+  return _BV(REFS0) | ((pin >= A0 ? pin - A0 : pin) & 0x07);
+}
+#endif
+
+JoystickAdc::JoystickAdc(uint8_t pinX, uint8_t pinY)
+  : channel(0), blockCount(0), front(0), sequence(0), seenSequence(0), calibrated(false) {
+  pins[0] = pinX;
+  pins[1] = pinY;
+  for (uint8_t a = 0; a < 2; a++) {
+    sums[a] = 0;
+    published[0][a] = published[1][a] = 512;
+    latest[a] = 512;
+    centerQ4[a] = 512 << 4;
+    noiseQ4[a] = 0;
+  }
+}
+
+void JoystickAdc::begin() {
+#if defined(__AVR__)
+  adcOwner = this;
+  channel = 0;
+  // /128 prescaler (125 kHz ADC clock, ~104 us per conversion), interrupt
+  // on completion, first conversion started now
+  ADMUX = adcMux(pins[0]);
+  ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0) | _BV(ADSC);
+#endif
+}
+
+uint8_t JoystickAdc::handleConversion(uint16_t raw) {
+  sums[channel] += raw;
+  if (channel == 1 && ++blockCount == oversample) {
+    // Fill the half the reader isn't looking at, then flip
+    uint8_t back = front ^ 1;
+    published[back][0] = sums[0] / oversample;
+    published[back][1] = sums[1] / oversample;
+    front = back;
+    sequence++;
+    sums[0] = sums[1] = 0;
+    blockCount = 0;
+  }
+  channel ^= 1;
+  return pins[channel];
+}
+
+#if defined(__AVR__)
+ISR(ADC_vect) {
+  uint8_t next = adcOwner->handleConversion(ADC);
+  // Single conversions restarted from here rather than free-running mode,
+  // so the multiplexer switch never lands mid-conversion
+  ADMUX = adcMux(next);
+  ADCSRA |= _BV(ADSC);
+}
+#endif
+
+void JoystickAdc::update() {
+#if !defined(__AVR__)
+  handleConversion(analogRead(pins[channel]));
+#endif
+  if (sequence == seenSequence) return;
+  seenSequence = sequence;
+  // A whole block takes milliseconds to fill, so `front` cannot flip twice
+  // while these two words are copied
+  uint8_t f = front;
+  latest[0] = published[f][0];
+  latest[1] = published[f][1];
+
+  if (!calibrated) {
+    // Whatever the stick reads at power-up is rest, unless it is clearly held
+    for (uint8_t a = 0; a < 2; a++) {
+      uint16_t v = (latest[a] >= 256 && latest[a] < 768) ? latest[a] : 512;
+      centerQ4[a] = v << 4;
+    }
+    calibrated = true;
+    return;
+  }
+  calibrate(0, latest[0]);
+  calibrate(1, latest[1]);
+}
+
+void JoystickAdc::calibrate(uint8_t axis, uint16_t v) {
+  int16_t offsetQ4 = (int16_t)(v << 4) - (int16_t)centerQ4[axis];
+  uint16_t distQ4 = offsetQ4 < 0 ? -offsetQ4 : offsetQ4;
+  // Only samples well inside the dead zone count as rest; a deliberate push
+  // never drags the center along
+  if ((distQ4 >> 4) >= deadZone(axis) / 2) return;
+  centerQ4[axis] += offsetQ4 / 16;
+  noiseQ4[axis] += ((int16_t)distQ4 - (int16_t)noiseQ4[axis]) / 8;
+}
+
+uint16_t JoystickAdc::deadZone(uint8_t axis) const {
+  // Four times the rest noise on top of a floor for mechanical slop
+  uint16_t zone = minDeadZone + (noiseQ4[axis] >> 2);
+  return zone < maxDeadZone ? zone : maxDeadZone;
+}
+
+int8_t JoystickAdc::direction(uint8_t axis) const {
+  uint16_t c = center(axis);
+  uint16_t zone = deadZone(axis);
+  if (latest[axis] + zone < c) return -1;
+  if (latest[axis] > c + zone) return 1;
+  return 0;
+}
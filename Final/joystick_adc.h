@@ -0,0 +1,62 @@
+#ifndef JOYSTICK_ADC_H
+#define JOYSTICK_ADC_H
+
+#include <Arduino.h>
+
+// Two-axis joystick sampled in the background. On the AVR the ADC-complete
+// interrupt alternates between the two channels, starting each conversion
+// from the previous one's ISR, and publishes an oversampled average of
+// both axes into a double buffer. update() picks up the newest pair without
+// waiting on the ADC and keeps a running calibration of each axis' rest
+// center and dead zone.
+//
+// Elsewhere (host builds, boards without the AVR ADC registers) update()
+// takes one analogRead() of the next channel per call instead.
+//
+// Once begin() has run the ADC belongs to this class: no analogRead() on AVR.
+class JoystickAdc {
+public:
+  JoystickAdc(uint8_t pinX, uint8_t pinY);
+
+  void begin();
+  // Main-context half: fetch the latest published sample, refine calibration
+  void update();
+
+  uint16_t value(uint8_t axis) const { return latest[axis]; }
+  // -1 below the dead zone, 1 above it, 0 inside
+  int8_t direction(uint8_t axis) const;
+  uint16_t center(uint8_t axis) const { return centerQ4[axis] >> 4; }
+  uint16_t deadZone(uint8_t axis) const;
+
+  // ISR half: one finished conversion on the current channel. Returns the
+  // pin to convert next.
+  uint8_t handleConversion(uint16_t raw);
+
+#if defined(__AVR__)
+  static const uint8_t oversample = 16;
+#else
+  static const uint8_t oversample = 1;
+#endif
+  static const uint16_t minDeadZone = 60;
+  static const uint16_t maxDeadZone = 200;
+
+private:
+  void calibrate(uint8_t axis, uint16_t v);
+
+  uint8_t pins[2];
+  // ISR state
+  volatile uint8_t channel;
+  uint8_t blockCount;
+  uint16_t sums[2];
+  volatile uint16_t published[2][2];
+  volatile uint8_t front;     // which half of `published` is complete
+  volatile uint8_t sequence;  // bumped on every publish
+  // Main-context state
+  uint8_t seenSequence;
+  bool calibrated;
+  uint16_t latest[2];
+  uint16_t centerQ4[2];       // 1/16 count fixed point
+  uint16_t noiseQ4[2];        // mean distance from center while at rest
+};
+
+#endif
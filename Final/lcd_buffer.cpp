@@ -0,0 +1,131 @@
+#include "lcd_buffer.h"
+
+// The HD44780 keeps 40 addresses per line; only the first 16 are visible
+static const uint8_t lineAddresses = 40;
+
+LcdBuffer::LcdBuffer(LiquidCrystal &device)
+  : lcd(device), writeCol(0), writeRow(0), cursorWanted(false),
+    deviceCol(0), deviceRow(0), deviceCursorKnown(true), deviceCursorShown(false) {
+  for (uint8_t r = 0; r < rows; r++) {
+    memset(text[r], ' ', cols);
+    text[r][cols] = '\0';
+    memset(shown[r], ' ', cols);
+    dirty[r] = 0;
+  }
+  resetStats();
+}
+
+void LcdBuffer::markCell(uint8_t col, uint8_t row) {
+  uint16_t bit = (uint16_t)(1u << col);
+  if (text[row][col] != shown[row][col]) dirty[row] |= bit;
+  else dirty[row] &= ~bit;
+}
+
+void LcdBuffer::clear() {
+  for (uint8_t r = 0; r < rows; r++) {
+    memset(text[r], ' ', cols);
+    for (uint8_t c = 0; c < cols; c++) markCell(c, r);
+  }
+  writeCol = 0;
+  writeRow = 0;
+}
+
+void LcdBuffer::setCursor(uint8_t col, uint8_t row) {
+  writeCol = col < lineAddresses ? col : lineAddresses - 1;
+  writeRow = row < rows ? row : rows - 1;
+}
+
+void LcdBuffer::cursor() {
+  cursorWanted = true;
+}
+
+void LcdBuffer::noCursor() {
+  cursorWanted = false;
+}
+
+size_t LcdBuffer::write(uint8_t c) {
+  if (writeCol < cols) {
+    text[writeRow][writeCol] = (char)c;
+    markCell(writeCol, writeRow);
+  }
+  if (writeCol < lineAddresses) writeCol++;
+  return 1;
+}
+
+bool LcdBuffer::pending() const {
+  for (uint8_t r = 0; r < rows; r++) {
+    if (dirty[r]) return true;
+  }
+  if (!cursorWanted) return deviceCursorShown;
+  bool cursorPlaced = deviceCursorKnown && deviceCol == writeCol && deviceRow == writeRow;
+  return !cursorPlaced || !deviceCursorShown;
+}
+
+bool LcdBuffer::flush(uint16_t budgetMicros) {
+  if (!pending()) return true;
+  counters.flushes++;
+  uint32_t start = micros();
+  uint8_t transfers = 0;
+
+  while (true) {
+    // Find the first changed cell, row-major, so runs of changes on one
+    // line go out back to back without cursor moves in between
+    uint8_t r = 0;
+    while (r < rows && !dirty[r]) r++;
+    if (r < rows) {
+      uint8_t c = 0;
+      while (!(dirty[r] & (uint16_t)(1u << c))) c++;
+      if (!deviceCursorKnown || deviceCol != c || deviceRow != r) {
+        lcd.setCursor(c, r);
+        deviceCol = c;
+        deviceRow = r;
+        deviceCursorKnown = true;
+        counters.commandsSent++;
+      } else {
+        lcd.write((uint8_t)text[r][c]);
+        shown[r][c] = text[r][c];
+        dirty[r] &= ~(uint16_t)(1u << c);
+        deviceCol++;
+        counters.charsSent++;
+      }
+    } else if (cursorWanted) {
+      // The visible cursor sits at the device's address counter, so it is
+      // parked only after all text is out
+      if (!deviceCursorKnown || deviceCol != writeCol || deviceRow != writeRow) {
+        lcd.setCursor(writeCol, writeRow);
+        deviceCol = writeCol;
+        deviceRow = writeRow;
+        deviceCursorKnown = true;
+      } else {
+        lcd.cursor();
+        deviceCursorShown = true;
+      }
+      counters.commandsSent++;
+    } else {
+      lcd.noCursor();
+      deviceCursorShown = false;
+      counters.commandsSent++;
+    }
+    transfers++;
+
+    if (!pending()) return true;
+    // Stop before a transfer that would probably run past the budget,
+    // judging by the average cost of the ones sent so far
+    uint32_t elapsed = micros() - start;
+    if (elapsed + elapsed / transfers > budgetMicros) {
+      counters.flushesCut++;
+      return false;
+    }
+  }
+}
+
+void LcdBuffer::invalidate() {
+  for (uint8_t r = 0; r < rows; r++) dirty[r] = (uint16_t)(0xFFFFu >> (16 - cols));
+  deviceCursorKnown = false;
+  // Pretend the opposite of what we want so the cursor state is resent too
+  deviceCursorShown = !cursorWanted;
+}
+
+void LcdBuffer::resetStats() {
+  memset(&counters, 0, sizeof(counters));
+}
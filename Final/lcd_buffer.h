@@ -0,0 +1,64 @@
+#ifndef LCD_BUFFER_H
+#define LCD_BUFFER_H
+
+#include <Arduino.h>
+#include <LiquidCrystal.h>
+
+struct LcdBufferStats {
+  uint32_t flushes;
+  uint32_t flushesCut;   // passes that stopped on the time budget with work left
+  uint32_t charsSent;
+  uint32_t commandsSent; // cursor moves and cursor on/off
+};
+
+// 16x2 shadow of the HD44780 text. Handlers print into it as if it were the
+// LCD; nothing reaches the device until flush(), which sends only the
+// characters that differ from what is on screen and stops once its time
+// budget is used up, picking up where it left off on the next call.
+class LcdBuffer : public Print {
+public:
+  static const uint8_t cols = 16;
+  static const uint8_t rows = 2;
+
+  // Assumes the device is blank, as it is right after begin()
+  explicit LcdBuffer(LiquidCrystal &device);
+
+  // Same meaning as on LiquidCrystal, but they only touch the buffer
+  void clear();
+  void setCursor(uint8_t col, uint8_t row);
+  void cursor();
+  void noCursor();
+
+  virtual size_t write(uint8_t c);
+  using Print::write;
+
+  // Sends changes for up to budgetMicros (always at least one transfer).
+  // Returns true once the device matches the buffer.
+  bool flush(uint16_t budgetMicros);
+  bool pending() const;
+  // Force a full resend, e.g. after the device was reset behind our back
+  void invalidate();
+
+  const char *line(uint8_t row) const { return text[row]; }
+  const LcdBufferStats &stats() const { return counters; }
+  void resetStats();
+
+private:
+  void markCell(uint8_t col, uint8_t row);
+
+  LiquidCrystal &lcd;
+  char text[rows][cols + 1];
+  char shown[rows][cols];
+  uint16_t dirty[rows];   // bit c set: column c differs from the device
+  uint8_t writeCol;
+  uint8_t writeRow;
+  bool cursorWanted;
+  // Device side: address counter (unknown after invalidate) and cursor state
+  uint8_t deviceCol;
+  uint8_t deviceRow;
+  bool deviceCursorKnown;
+  bool deviceCursorShown;
+  LcdBufferStats counters;
+};
+
+#endif
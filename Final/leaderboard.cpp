@@ -0,0 +1,166 @@
+#include "leaderboard.h"
+#include "eeprom_journal.h"
+
+Leaderboards::Leaderboards(EepromQueue &store, uint16_t start, uint8_t tableCount, uint8_t tableCapacity)
+  : eeprom(store), base(start), tables(tableCount), entries(tableCapacity) {
+}
+
+LeaderboardRecord Leaderboards::pack(uint16_t score, const char *name) {
+  LeaderboardRecord record = score;
+  for (uint8_t i = 0; i < nameLength; i++) {
+    char c = name[i];
+    record = (record << letterBits) | ((c >= 'A' && c <= 'Z') ? c - 'A' + 1 : 0);
+  }
+  return record;
+}
+
+void Leaderboards::unpackName(LeaderboardRecord record, char *out) {
+  for (uint8_t i = nameLength; i-- > 0;) {
+    uint8_t letter = record & ((1u << letterBits) - 1);
+    out[i] = (letter >= 1 && letter <= 26) ? 'A' + letter - 1 : '-';
+    record >>= letterBits;
+  }
+  out[nameLength] = '\0';
+}
+
+LeaderboardRecord Leaderboards::slotRecord(uint8_t table, uint8_t slot) {
+  uint16_t addr = slotAddress(table, slot);
+  LeaderboardRecord record = 0;
+  for (uint8_t i = recordSize; i-- > 0;) record = (record << 8) | eeprom.read(addr + i);
+  return record;
+}
+
+void Leaderboards::writeRecord(uint8_t table, uint8_t slot, LeaderboardRecord record) {
+  uint16_t addr = slotAddress(table, slot);
+  for (uint8_t i = 0; i < recordSize; i++) {
+    eeprom.update(addr + i, (uint8_t)record);
+    record >>= 8;
+  }
+}
+
+uint8_t Leaderboards::intentCheck(uint8_t table, uint8_t rank, uint8_t slot, uint8_t used) {
+  uint16_t crc = crc16Update(0xFFFF, table);
+  crc = crc16Update(crc, rank);
+  crc = crc16Update(crc, slot);
+  return (uint8_t)crc16Update(crc, used);
+}
+
+uint16_t Leaderboards::tableCrc(uint8_t table, uint8_t used) {
+  uint16_t crc = crc16Update(0xFFFF, table);
+  crc = crc16Update(crc, used);
+  for (uint8_t rank = 0; rank < used; rank++) {
+    uint8_t slot = slotOf(table, rank);
+    crc = crc16Update(crc, slot);
+    uint16_t addr = slotAddress(table, slot);
+    for (uint8_t i = 0; i < recordSize; i++) crc = crc16Update(crc, eeprom.read(addr + i));
+  }
+  return crc;
+}
+
+// Count and CRC go last, after the order they describe is queued
+void Leaderboards::seal(uint8_t table, uint8_t used) {
+  uint16_t addr = tableAddress(table);
+  uint16_t crc = tableCrc(table, used);
+  eeprom.update(addr, ~used);
+  eeprom.update(addr + 1, (uint8_t)crc);
+  eeprom.update(addr + 2, (uint8_t)(crc >> 8));
+}
+
+bool Leaderboards::intact(uint8_t table) {
+  uint8_t used = count(table);
+  if (used == 0) return true;
+  if (used > entries) return false;
+  for (uint8_t rank = 0; rank < used; rank++) {
+    if (slotOf(table, rank) > entries) return false;
+  }
+  uint16_t addr = tableAddress(table);
+  uint16_t stored = eeprom.read(addr + 1) | ((uint16_t)eeprom.read(addr + 2) << 8);
+  return tableCrc(table, used) == stored;
+}
+
+// Finishes the insert the table notes, if the note is good and the order
+// it leaves holds each slot once
+bool Leaderboards::resumeInsert(uint8_t table) {
+  uint16_t addr = intentAddress(table);
+  uint8_t rank = eeprom.read(addr);
+  uint8_t slot = eeprom.read(addr + 1);
+  uint8_t used = eeprom.read(addr + 2);
+  if (used == 0 || used > entries || rank >= used || slot > entries ||
+      eeprom.read(addr + 3) != intentCheck(table, rank, slot, used)) return false;
+
+  finishInsert(table, rank, slot, used);
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < used; i++) {
+    uint8_t s = slotOf(table, i);
+    if (s > entries || (seen & (1ul << s))) return false;
+    seen |= 1ul << s;
+  }
+  return true;
+}
+
+uint8_t Leaderboards::check() {
+  uint8_t broken = 0;
+  for (uint8_t table = 0; table < tables; table++) {
+    if (intact(table)) continue;
+    if (!resumeInsert(table)) clear(table);
+    broken |= 1 << table;
+  }
+  return broken;
+}
+
+void Leaderboards::clear(uint8_t table) {
+  seal(table, 0);
+}
+
+uint8_t Leaderboards::rankFor(uint8_t table, uint16_t score) {
+  uint8_t lo = 0;
+  uint8_t hi = count(table);
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) / 2;
+    if (Leaderboards::score(record(table, mid)) >= score) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// Moves the ranks from `rank` down one and puts `slot` at it. The shift
+// goes from the bottom up, so after a reset the ranks already moved are
+// the ones past the first pair of equal neighbours; only the rest are left.
+void Leaderboards::finishInsert(uint8_t table, uint8_t rank, uint8_t slot, uint8_t used) {
+  uint16_t addr = orderAddress(table);
+  if (eeprom.read(addr + rank) != slot) {
+    uint8_t from = used - 1;
+    for (uint8_t i = rank + 1; i < used; i++) {
+      if (eeprom.read(addr + i) == eeprom.read(addr + i - 1)) {
+        from = i - 1;
+        break;
+      }
+    }
+    // Reads see the queued bytes
+    for (uint8_t i = from; i > rank; i--) eeprom.update(addr + i, eeprom.read(addr + i - 1));
+    eeprom.update(addr + rank, slot);
+  }
+  seal(table, used);
+}
+
+uint8_t Leaderboards::insert(uint8_t table, uint16_t score, const char *name) {
+  uint8_t rank = rankFor(table, score);
+  if (rank >= entries) return entries;
+
+  // The first slot the order does not use; a full table has one spare
+  uint8_t used = count(table);
+  uint32_t taken = 0;
+  for (uint8_t i = 0; i < used; i++) taken |= 1ul << slotOf(table, i);
+  uint8_t slot = 0;
+  while (taken & (1ul << slot)) slot++;
+  if (used < entries) used++;
+  writeRecord(table, slot, pack(score, name));
+
+  uint16_t addr = intentAddress(table);
+  eeprom.update(addr, rank);
+  eeprom.update(addr + 1, slot);
+  eeprom.update(addr + 2, used);
+  eeprom.update(addr + 3, intentCheck(table, rank, slot, used));
+  finishInsert(table, rank, slot, used);
+  return rank;
+}
@@ -0,0 +1,97 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <Arduino.h>
+#include "eeprom_queue.h"
+
+// One leaderboard entry packed into 32 bits: three 5-bit letters (1-26 for
+// A-Z, 0 for a blank) in the bottom 15 bits and the score above them, so
+// comparing two records compares their scores first.
+typedef uint32_t LeaderboardRecord;
+
+// Fixed-size sorted tables living in the EEPROM and read in place, so a
+// leaderboard screen costs one 5-byte read per line instead of a RAM copy.
+//
+// Table layout:
+// - entry count, inverted so an erased table reads as a valid empty one
+// - CRC-16 (LE) over the count, the used part of the order and the records
+//   it points at, seeded with the table number so a table that lands at
+//   another table's address is rejected too (an empty table needs none)
+// - the last insert: rank, slot, new count and a check byte
+// - the order: the slot of each rank, best first
+// - capacity + 1 record slots (LE)
+//
+// Records never move. An insert writes the new one to a slot the order
+// does not use (there is always one spare), notes what it is about to do,
+// then shifts the order down from the bottom up, puts the slot in at its
+// rank and reseals the count and CRC: at most maxInsertBytes() bytes.
+// After a reset mid-way, check() finishes the shift from where it stopped
+// (the last slot moved still sits next to its copy), so a torn insert
+// costs at most the new entry.
+//
+// All access goes through an EepromQueue, so insert() only queues bytes.
+class Leaderboards {
+public:
+  static const uint8_t nameLength = 3;
+  static const uint8_t letterBits = 5;
+  static const uint8_t nameBits = nameLength * letterBits;
+  static const uint8_t recordSize = 4;
+  static const uint8_t headerSize = 3;
+  static const uint8_t intentSize = 4;
+
+  static constexpr uint16_t tableSize(uint8_t capacity) {
+    return headerSize + intentSize + capacity + (uint16_t)(capacity + 1) * recordSize;
+  }
+
+  // Tables hold up to 31 entries
+  Leaderboards(EepromQueue &store, uint16_t start, uint8_t tableCount, uint8_t tableCapacity);
+
+  // Finishes an insert cut short by a reset and empties a table that fails
+  // its check all the same (erased or foreign). Bit t is set when table t
+  // was not intact; covers at most 8 tables.
+  uint8_t check();
+  void clear(uint8_t table);
+
+  uint8_t count(uint8_t table) { return ~eeprom.read(tableAddress(table)); }
+  LeaderboardRecord record(uint8_t table, uint8_t rank) { return slotRecord(table, slotOf(table, rank)); }
+
+  // Binary search: where `score` would go, after equal scores already
+  // there. Returns capacity if it does not make the table.
+  uint8_t rankFor(uint8_t table, uint16_t score);
+
+  // Returns the rank the entry took, capacity if it did not make the table
+  uint8_t insert(uint8_t table, uint16_t score, const char *name);
+  uint8_t maxInsertBytes() const { return recordSize + intentSize + entries + headerSize; }
+
+  uint8_t capacity() const { return entries; }
+  uint16_t end() const { return tableAddress(tables); }
+
+  static LeaderboardRecord pack(uint16_t score, const char *name);
+  static uint16_t score(LeaderboardRecord record) { return record >> nameBits; }
+  // Writes nameLength letters ('-' for blanks) and a terminator
+  static void unpackName(LeaderboardRecord record, char *out);
+
+private:
+  uint16_t tableAddress(uint8_t table) const { return base + (uint16_t)table * tableSize(entries); }
+  uint16_t intentAddress(uint8_t table) const { return tableAddress(table) + headerSize; }
+  uint16_t orderAddress(uint8_t table) const { return intentAddress(table) + intentSize; }
+  uint16_t slotAddress(uint8_t table, uint8_t slot) const {
+    return orderAddress(table) + entries + (uint16_t)slot * recordSize;
+  }
+  uint8_t slotOf(uint8_t table, uint8_t rank) { return eeprom.read(orderAddress(table) + rank); }
+  LeaderboardRecord slotRecord(uint8_t table, uint8_t slot);
+  void writeRecord(uint8_t table, uint8_t slot, LeaderboardRecord record);
+  uint8_t intentCheck(uint8_t table, uint8_t rank, uint8_t slot, uint8_t used);
+  bool intact(uint8_t table);
+  bool resumeInsert(uint8_t table);
+  void finishInsert(uint8_t table, uint8_t rank, uint8_t slot, uint8_t used);
+  uint16_t tableCrc(uint8_t table, uint8_t used);
+  void seal(uint8_t table, uint8_t used);
+
+  EepromQueue &eeprom;
+  uint16_t base;
+  uint8_t tables;
+  uint8_t entries;
+};
+
+#endif
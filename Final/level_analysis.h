@@ -0,0 +1,107 @@
+#ifndef LEVEL_ANALYSIS_H
+#define LEVEL_ANALYSIS_H
+
+#include <Arduino.h>
+#include "level_geometry.h"
+
+// Bit-parallel breadth-first search over level rows. A set of cells is one
+// Row word per level row (same layout as the walls), so one BFS layer is a
+// handful of shifts, ORs and ANDs per row instead of a queue of cells.
+
+template <typename Geometry>
+inline typename Geometry::Row levelOpenRow(const void *level, uint8_t r) {
+  typedef typename Geometry::Row Row;
+  Row walls = Geometry::readRow(level, r);
+  return (Row)(~walls & levelWidthMask<Row>(Geometry::width));
+}
+
+template <typename Geometry>
+inline void floodSeed(typename Geometry::Row *visited, typename Geometry::Row *frontier,
+                      uint8_t c, uint8_t r) {
+  memset(visited, 0, sizeof(typename Geometry::Row) * Geometry::height);
+  memset(frontier, 0, sizeof(typename Geometry::Row) * Geometry::height);
+  visited[r] = frontier[r] = levelColumnMask<typename Geometry::Row>(c);
+}
+
+// Advances the frontier by one layer: after k steps `visited` holds every
+// open cell within path distance k of the seed. Returns false once nothing
+// new was reached.
+template <typename Geometry>
+bool floodStep(const void *level, typename Geometry::Row *visited,
+               typename Geometry::Row *frontier) {
+  typedef typename Geometry::Row Row;
+  Row above = 0; // previous row's frontier before it was overwritten
+  Row grew = 0;
+  for (uint8_t r = 0; r < Geometry::height; r++) {
+    Row current = frontier[r];
+    Row below = (r + 1 < Geometry::height) ? frontier[r + 1] : 0;
+    Row reach = (Row)(current << 1) | (Row)(current >> 1) | above | below;
+    Row fresh = reach & levelOpenRow<Geometry>(level, r) & (Row)~visited[r];
+    frontier[r] = fresh;
+    visited[r] |= fresh;
+    grew |= fresh;
+    above = current;
+  }
+  return grew != 0;
+}
+
+// Marks in `valid` the cells reachable from the start whose shortest path is
+// at least minStart steps from the start and at least minExit steps from
+// the exit.
+template <typename Geometry>
+void findStarCells(const void *level,
+                   uint8_t startCol, uint8_t startRow, uint8_t exitCol, uint8_t exitRow,
+                   uint8_t minStart, uint8_t minExit, typename Geometry::Row *valid) {
+  typedef typename Geometry::Row Row;
+  Row visited[Geometry::height];
+  Row frontier[Geometry::height];
+
+  // `valid` collects the excluded cells first
+  floodSeed<Geometry>(visited, frontier, exitCol, exitRow);
+  for (uint8_t d = 1; d < minExit && floodStep<Geometry>(level, visited, frontier); d++);
+  memcpy(valid, visited, sizeof(visited));
+
+  floodSeed<Geometry>(visited, frontier, startCol, startRow);
+  uint8_t d = 1;
+  for (; d < minStart && floodStep<Geometry>(level, visited, frontier); d++);
+  for (uint8_t r = 0; r < Geometry::height; r++) valid[r] |= visited[r];
+  while (floodStep<Geometry>(level, visited, frontier));
+
+  for (uint8_t r = 0; r < Geometry::height; r++) valid[r] = visited[r] & (Row)~valid[r];
+}
+
+template <typename Row>
+inline uint8_t countRowCells(Row bits) {
+  uint8_t n = 0;
+  for (; bits; n++) bits &= (Row)(bits - 1);
+  return n;
+}
+
+// Picks min(count, cells) cells uniformly at random from `cells` in a single
+// row-major pass (selection sampling), calling emit(col, row) for each.
+// `rng(n)` must return a value in [0, n). Returns how many were picked.
+template <typename Geometry, typename Rng, typename Emit>
+uint8_t sampleCells(const typename Geometry::Row *cells, uint8_t count, Rng &rng, Emit emit) {
+  typedef typename Geometry::Row Row;
+  uint16_t remaining = 0;
+  for (uint8_t r = 0; r < Geometry::height; r++) remaining += countRowCells<Row>(cells[r]);
+
+  uint8_t needed = remaining < count ? remaining : count;
+  uint8_t picked = needed;
+  for (uint8_t r = 0; r < Geometry::height && needed > 0; r++) {
+    Row bits = cells[r];
+    for (uint8_t c = 0; bits && needed > 0; c++) {
+      Row mask = levelColumnMask<Row>(c);
+      if (!(bits & mask)) continue;
+      bits &= (Row)~mask;
+      if (rng(remaining) < needed) {
+        emit(c, r);
+        needed--;
+      }
+      remaining--;
+    }
+  }
+  return picked;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef LEVEL_GEOMETRY_H
+#define LEVEL_GEOMETRY_H
+
+#include <Arduino.h>
+#include "viewport.h"
+
+// Compile-time level shapes. Width and height are template parameters, so
+// every wall test, bounds check and viewport extraction is instantiated per
+// shape with constant masks and limits instead of generic runtime indexing.
+
+template <bool Condition, typename IfTrue, typename IfFalse>
+struct SelectType { typedef IfTrue type; };
+
+template <typename IfTrue, typename IfFalse>
+struct SelectType<false, IfTrue, IfFalse> { typedef IfFalse type; };
+
+// Narrowest unsigned word that holds one level row
+template <uint8_t Width>
+struct LevelRowStorage {
+  typedef typename SelectType<(Width <= 8), uint8_t,
+          typename SelectType<(Width <= 16), uint16_t,
+          typename SelectType<(Width <= 32), uint32_t, uint64_t>::type>::type>::type type;
+};
+
+// Source says where the rows are read from (see viewport.h, level_pack.h)
+template <uint8_t W, uint8_t H, typename Source = ProgmemRows>
+struct LevelGeometry {
+  static_assert(W > 0 && W <= 64, "level rows are at most 64 columns");
+  static_assert(H > 0, "level needs at least one row");
+
+  typedef typename LevelRowStorage<W>::type Row;
+
+  static const uint8_t width = W;
+  static const uint8_t height = H;
+
+  static bool inBounds(uint8_t c, uint8_t r) {
+    return c < W && r < H;
+  }
+
+  static Row readRow(const void *level, uint8_t r) {
+    return Source::template read<Row>(level, W, r);
+  }
+
+  // Anything outside the level counts as wall
+  static bool isWall(const void *level, uint8_t c, uint8_t r) {
+    if (!inBounds(c, r)) return true;
+    return Source::template cell<Row>(level, W, c, r);
+  }
+
+  // Left/top edge of a window of `size` cells centred on `pos`
+  static uint8_t viewportColOffset(uint8_t pos, uint8_t size) {
+    return W > size ? constrain((int16_t)pos - size / 2, 0, W - size) : 0;
+  }
+
+  static uint8_t viewportRowOffset(uint8_t pos, uint8_t size) {
+    return H > size ? constrain((int16_t)pos - size / 2, 0, H - size) : 0;
+  }
+
+  template <uint8_t PanelWidth, uint8_t PanelHeight>
+  static void extract(const void *level, uint8_t colOffset, uint8_t rowOffset,
+                      const Row *overlay, uint8_t *out) {
+    extractViewport<Row, Source, PanelWidth, PanelHeight>(level, W, H, colOffset, rowOffset, overlay, out);
+  }
+};
+
+#endif
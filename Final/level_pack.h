@@ -0,0 +1,98 @@
+#ifndef LEVEL_PACK_H
+#define LEVEL_PACK_H
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+#include "viewport.h"
+
+// Built-in levels are kept as a level pack: every level is cut into 4x4
+// tiles, identical tiles across all levels share one entry of a common
+// dictionary, and a level itself is only its grid of byte tile indices
+// (row-major, ceil(width / 4) per tile row). The pack is generated from
+// levels.txt by host/tools/level_packer into level_pack_data.h.
+//
+// A dictionary tile is one 16-bit word: the top tile row in the high nibble,
+// and column 0 of each tile row in the nibble's MSB, the same orientation as
+// the level rows. Tiles hanging past the level edge are padded with wall.
+
+const uint8_t levelTileSize = 4;
+
+// The pack also carries each level's path table, baked by the packer with
+// a breadth-first search back from the exit: one nibble per cell, two cells
+// a byte (even column in the high nibble), ceil(width / 2) bytes a row. The
+// high two bits are the next step towards the exit (0 up, 1 down, 2 left,
+// 3 right, i.e. DIR_* - 1), the low two bits the path distance to the exit
+// mod 4, the layer of the search. Walls and the exit itself are 0. Every
+// open cell reaches the exit (the packer checks), so following the next
+// hops from any of them ends there.
+const uint8_t levelPathLayers = 4;
+
+// Defined by level_pack_data.h
+extern const uint16_t levelTiles[] PROGMEM;
+
+inline uint8_t levelTileRowBits(uint8_t tile, uint8_t r) {
+  return (pgm_read_word(&levelTiles[tile]) >> ((levelTileSize - 1 - r) * levelTileSize)) & 0x0F;
+}
+
+inline uint8_t levelTilesPerRow(uint8_t width) {
+  return (width + levelTileSize - 1) / levelTileSize;
+}
+
+inline uint8_t levelPathNibble(const uint8_t *paths, uint8_t width, uint8_t c, uint8_t r) {
+  uint8_t pair = pgm_read_byte(paths + r * ((width + 1) / 2) + c / 2);
+  return (c & 1) ? pair & 0x0F : pair >> 4;
+}
+
+// Distance to the exit mod levelPathLayers; only meaningful on open cells
+inline uint8_t levelExitLayer(const uint8_t *paths, uint8_t width, uint8_t c, uint8_t r) {
+  return levelPathNibble(paths, width, c, r) & 0x03;
+}
+
+// Only meaningful on open cells other than the exit
+inline uint8_t levelNextHop(const uint8_t *paths, uint8_t width, uint8_t c, uint8_t r) {
+  return levelPathNibble(paths, width, c, r) >> 2;
+}
+
+// Steps from the open cell (c, r) to the exit along the next hops, one
+// flash read each; stops at `limit` if the exit is further
+inline uint16_t levelExitDistance(const uint8_t *paths, uint8_t width, uint8_t c, uint8_t r,
+                                  uint8_t exitCol, uint8_t exitRow, uint16_t limit) {
+  uint16_t steps = 0;
+  for (; steps < limit && (c != exitCol || r != exitRow); steps++) {
+    switch (levelNextHop(paths, width, c, r)) {
+      case 0: r--; break;
+      case 1: r++; break;
+      case 2: c--; break;
+      default: c++; break;
+    }
+  }
+  return steps;
+}
+
+// Row source for LevelGeometry that decodes straight from the pack, so a
+// level is never expanded into RAM. A row costs two flash reads per tile
+// column, a cell two reads.
+struct TiledRows {
+  template <typename RowT>
+  static RowT read(const void *level, uint8_t width, uint8_t r) {
+    const uint8_t bits = sizeof(RowT) * 8;
+    uint8_t tiles = levelTilesPerRow(width);
+    const uint8_t *map = (const uint8_t *)level + (r / levelTileSize) * tiles;
+    uint8_t tileR = r % levelTileSize;
+    RowT row = 0;
+    for (uint8_t t = 0; t < tiles; t++) {
+      uint8_t shift = bits - levelTileSize * (t + 1);
+      row |= (RowT)((RowT)levelTileRowBits(pgm_read_byte(map + t), tileR) << shift);
+    }
+    return row;
+  }
+
+  template <typename RowT>
+  static bool cell(const void *level, uint8_t width, uint8_t c, uint8_t r) {
+    const uint8_t *map = (const uint8_t *)level + (r / levelTileSize) * levelTilesPerRow(width);
+    uint8_t tile = pgm_read_byte(map + c / levelTileSize);
+    return levelTileRowBits(tile, r % levelTileSize) & (0x08 >> (c % levelTileSize));
+  }
+};
+
+#endif
@@ -0,0 +1,178 @@
+// Generated by host/tools/level_packer from levels.txt, do not edit.
+// 5 levels, 104 distinct 4x4 tiles: 208 dictionary + 129 map bytes
+// (288 bytes as plain row arrays), 1032 path table bytes packed (2064 at a byte a cell).
+// Included by main.cpp after makePackedLevelDef.
+
+const uint16_t levelTiles[104] PROGMEM = {
+  0xF8E8, 0xF11F, 0xE88F, 0x1F1F, 0xF8F8, 0xF001, 0xF77F, 0x9989,
+  0x880F, 0x1F11, 0x998F, 0xFF0F, 0x111F, 0xF88B, 0xF30E, 0xFE03,
+  0xF111, 0x88BB, 0x03FF, 0x3FFF, 0x1111, 0x8999, 0xC077, 0x1191,
+  0x8B8F, 0x0C0F, 0x770F, 0xFAA8, 0xF0AA, 0xF0EA, 0xF0E2, 0xF8B0,
+  0xF3B3, 0xE8B8, 0xA8E0, 0xB8A2, 0xBAA8, 0xF2A8, 0xF3BB, 0xAAA8,
+  0xB2E0, 0xE8B2, 0xF0F0, 0xE8A2, 0xBBBB, 0xB8F8, 0xF2AA, 0xA0D0,
+  0xF8B8, 0xA2BA, 0xB3B3, 0xAAB8, 0xB8E8, 0xE0F0, 0x2AA2, 0xAABA,
+  0xAAFF, 0xB0FF, 0xE2FF, 0xA2FF, 0xA0FF, 0xF3FF, 0xFABA, 0xF0A2,
+  0xF8A8, 0xF0F8, 0xF0E0, 0xFBB3, 0xE2A0, 0xA8F0, 0xB8E0, 0xA2AA,
+  0xBAB8, 0xE8BA, 0xF8B2, 0x70B0, 0xAAA2, 0xA2E2, 0xA8B8, 0xE0B0,
+  0xE0B2, 0xAAA0, 0xF070, 0xAAE8, 0xE83A, 0xB0B8, 0xE098, 0xE8E2,
+  0xAAF0, 0xB8BA, 0xA0E2, 0xE2A8, 0x38E0, 0xE2BA, 0xB3F3, 0xB8EA,
+  0xB8AA, 0xA2EA, 0xA8F2, 0xBBB3, 0xB8FF, 0xF0FF, 0xE0FF, 0xBBFF
+};
+
+const uint8_t levelMap1[4] PROGMEM = {
+  0, 1,
+  2, 3
+};
+
+// Exit 10 steps from the start
+const uint8_t levelPaths1[32] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00,
+  0x0E, 0xD4, 0x56, 0x70,
+  0x00, 0x07, 0x89, 0xA0,
+  0x0C, 0xF6, 0x00, 0x00,
+  0x00, 0x05, 0xAB, 0x80,
+  0x06, 0x54, 0x00, 0x00,
+  0x0D, 0xCF, 0xED, 0x00,
+  0x00, 0x00, 0x00, 0x00
+};
+
+const uint8_t levelMap2[9] PROGMEM = {
+  4, 5, 6,
+  7, 8, 9,
+  10, 11, 12
+};
+
+// Exit 18 steps from the start
+const uint8_t levelPaths2[72] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x0E, 0xDC, 0x76, 0x56, 0x70, 0x00,
+  0x00, 0x00, 0x65, 0x49, 0xA0, 0x00,
+  0x04, 0x7E, 0xD4, 0x70, 0x00, 0x00,
+  0x07, 0x60, 0x07, 0x65, 0xAB, 0x80,
+  0x06, 0x50, 0x06, 0x54, 0x00, 0x00,
+  0x05, 0x4F, 0xED, 0xCF, 0x65, 0x40,
+  0x04, 0x70, 0x00, 0x00, 0x54, 0x70,
+  0x07, 0x60, 0x00, 0x00, 0x47, 0x60,
+  0x06, 0x50, 0x00, 0x00, 0x76, 0x50,
+  0x0D, 0xCF, 0xED, 0xCF, 0xED, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+const uint8_t levelMap3[16] PROGMEM = {
+  13, 14, 15, 16,
+  17, 18, 19, 20,
+  21, 19, 22, 23,
+  24, 25, 26, 12
+};
+
+// Exit 26 steps from the start
+const uint8_t levelPaths3[128] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x06, 0x54, 0x76, 0x00, 0x00, 0x04, 0x76, 0x50,
+  0x05, 0xCF, 0xED, 0xCF, 0xED, 0xCF, 0x65, 0x40,
+  0x04, 0x00, 0x00, 0x00, 0x32, 0x00, 0x54, 0x70,
+  0x07, 0x45, 0xCF, 0xE1, 0x03, 0x00, 0x47, 0x60,
+  0x06, 0xB8, 0x10, 0x00, 0x00, 0x00, 0x76, 0x50,
+  0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x65, 0x40,
+  0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x54, 0x70,
+  0x07, 0x6B, 0x89, 0x00, 0x00, 0x65, 0x47, 0x60,
+  0x06, 0x50, 0x00, 0x00, 0x7E, 0xDC, 0xF6, 0x50,
+  0x05, 0x40, 0x00, 0x00, 0x60, 0x00, 0x05, 0x40,
+  0x04, 0x70, 0x00, 0x00, 0x50, 0x00, 0x54, 0x70,
+  0x07, 0xED, 0xCF, 0x65, 0x40, 0x00, 0x47, 0x60,
+  0x06, 0x00, 0x00, 0x54, 0x70, 0x00, 0x76, 0x50,
+  0x0D, 0xCF, 0xED, 0xCF, 0xED, 0xCF, 0xED, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+const uint8_t levelMap4[36] PROGMEM = {
+  27, 28, 29, 30, 31, 32,
+  33, 34, 35, 36, 37, 38,
+  39, 40, 41, 42, 43, 44,
+  45, 46, 47, 48, 49, 50,
+  51, 52, 53, 54, 55, 32,
+  56, 57, 58, 59, 60, 61
+};
+
+// Exit 46 steps from the start
+const uint8_t levelPaths4[288] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x06, 0x04, 0x9C, 0xFE, 0xDC, 0xF6, 0xB8, 0x9A, 0x04, 0x9A, 0xB4, 0x00,
+  0x05, 0x07, 0x01, 0x03, 0x00, 0x05, 0x00, 0x03, 0x07, 0x00, 0x07, 0x00,
+  0x0C, 0xF6, 0x04, 0x06, 0x04, 0x0C, 0xF6, 0x00, 0x9A, 0xB8, 0x9A, 0x00,
+  0x00, 0x05, 0x07, 0x05, 0x07, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x06, 0xB8, 0x0E, 0xD4, 0x0E, 0xD4, 0x04, 0x0E, 0xD4, 0x06, 0xB4, 0x00,
+  0x05, 0x00, 0x00, 0x07, 0x03, 0x07, 0x07, 0x03, 0x07, 0x05, 0x07, 0x00,
+  0x04, 0xF6, 0xB4, 0x9A, 0xD0, 0x06, 0x0E, 0xD0, 0x0E, 0xD4, 0x06, 0x00,
+  0x07, 0x05, 0x07, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x07, 0x05, 0x00,
+  0x06, 0x04, 0x9A, 0x04, 0x06, 0xB8, 0x9A, 0xB8, 0x04, 0x9A, 0x04, 0x00,
+  0x05, 0x07, 0x00, 0x07, 0x05, 0x00, 0x00, 0x00, 0x07, 0x03, 0x07, 0x00,
+  0x0C, 0xFE, 0xDC, 0xFE, 0xD4, 0x0C, 0xFE, 0xDC, 0xF6, 0x00, 0x06, 0x00,
+  0x01, 0x00, 0x00, 0x00, 0x07, 0x01, 0x00, 0x00, 0x05, 0x07, 0x05, 0x00,
+  0x0C, 0xFE, 0xD4, 0x04, 0xFE, 0x52, 0x04, 0xFE, 0xD4, 0x0E, 0xD4, 0x00,
+  0x00, 0x00, 0x07, 0x07, 0x00, 0x40, 0x07, 0x00, 0x07, 0x00, 0x07, 0x00,
+  0x06, 0xB8, 0x06, 0x0E, 0xDC, 0xF6, 0x0E, 0xD4, 0x06, 0x04, 0x9A, 0x00,
+  0x05, 0x01, 0x05, 0x00, 0x00, 0x0D, 0xC3, 0x07, 0x05, 0x07, 0x00, 0x00,
+  0x04, 0x02, 0x0C, 0xFE, 0xDC, 0xF2, 0x00, 0x06, 0x04, 0x0E, 0xD4, 0x00,
+  0x07, 0x00, 0x00, 0x03, 0x00, 0x00, 0x01, 0x05, 0x07, 0x00, 0x07, 0x00,
+  0x0E, 0xD4, 0x0E, 0xD0, 0xFE, 0xDC, 0xF2, 0x04, 0x06, 0x04, 0x9A, 0x00,
+  0x03, 0x07, 0x03, 0x00, 0x00, 0x01, 0x03, 0x07, 0x05, 0x07, 0x00, 0x00,
+  0x00, 0x0E, 0xD0, 0x9A, 0xB8, 0x02, 0xD0, 0x0E, 0xDC, 0xFE, 0xD0, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+const uint8_t levelMap5[64] PROGMEM = {
+  62, 63, 63, 64, 30, 65, 66, 67,
+  51, 68, 69, 70, 71, 33, 72, 50,
+  73, 42, 74, 75, 76, 77, 42, 50,
+  78, 74, 79, 41, 80, 81, 82, 32,
+  83, 84, 27, 85, 86, 87, 88, 32,
+  89, 90, 40, 91, 92, 52, 93, 94,
+  95, 69, 74, 30, 96, 97, 98, 99,
+  100, 101, 102, 102, 102, 100, 60, 103
+};
+
+// Exit 64 steps from the start
+const uint8_t levelPaths5[512] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x04, 0x0E, 0xDC, 0xF6, 0xB4, 0x9A, 0x0E, 0xDC, 0xFE, 0xD4, 0x9A, 0xB8, 0x9A, 0xB4, 0x06, 0x00,
+  0x07, 0x00, 0x01, 0x05, 0x07, 0x03, 0x03, 0x01, 0x00, 0x07, 0x00, 0x00, 0x00, 0x07, 0x05, 0x00,
+  0x06, 0x04, 0x92, 0x04, 0x9A, 0x00, 0x06, 0xDC, 0xF6, 0x06, 0x0C, 0xF6, 0xB8, 0x9A, 0xD4, 0x00,
+  0x05, 0x07, 0x00, 0x07, 0x03, 0x07, 0x05, 0x00, 0x05, 0x05, 0x00, 0x05, 0x01, 0x00, 0x07, 0x00,
+  0x04, 0x0E, 0xD4, 0x06, 0x00, 0x9A, 0x0C, 0xFE, 0xD4, 0x04, 0x06, 0xB8, 0x02, 0x0C, 0xF6, 0x00,
+  0x07, 0x00, 0x07, 0x05, 0x00, 0x00, 0x00, 0x03, 0x07, 0x07, 0x05, 0x00, 0x05, 0x00, 0x05, 0x00,
+  0x0E, 0xDC, 0xFE, 0xDC, 0xFE, 0xDC, 0x78, 0x9A, 0x06, 0x06, 0x04, 0xF6, 0x0C, 0xFE, 0xD4, 0x00,
+  0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x05, 0x05, 0x07, 0x05, 0x00, 0x00, 0x07, 0x00,
+  0x04, 0x92, 0xB8, 0x9A, 0x0C, 0xFE, 0xD4, 0x9A, 0x04, 0x04, 0x9A, 0x04, 0x9A, 0xB8, 0x96, 0x00,
+  0x07, 0x00, 0x00, 0x00, 0x01, 0x00, 0x07, 0x00, 0x07, 0x07, 0x00, 0x07, 0x00, 0x00, 0x05, 0x00,
+  0x06, 0x04, 0xFE, 0xDC, 0xF2, 0x04, 0xFE, 0xD4, 0x9A, 0x0E, 0xD4, 0x06, 0xB8, 0x9A, 0xB8, 0x00,
+  0x05, 0x07, 0x00, 0x00, 0x00, 0x07, 0x00, 0x07, 0x00, 0x03, 0x07, 0x05, 0x00, 0x00, 0x00, 0x00,
+  0x04, 0x9A, 0x0C, 0xFE, 0xD4, 0x9A, 0x04, 0x9A, 0xB8, 0x90, 0x06, 0x04, 0x5A, 0xB8, 0x96, 0x00,
+  0x07, 0x00, 0x01, 0x00, 0x07, 0x00, 0x07, 0x00, 0x01, 0x00, 0x05, 0x07, 0x40, 0x00, 0x05, 0x00,
+  0x0E, 0xDC, 0xF2, 0x0C, 0xFE, 0xDC, 0xF6, 0x0C, 0xF2, 0x06, 0xB8, 0x9A, 0xB8, 0x9A, 0xB8, 0x00,
+  0x03, 0x01, 0x00, 0x01, 0x00, 0x00, 0x05, 0x00, 0x00, 0x05, 0x00, 0x03, 0x01, 0x03, 0x00, 0x00,
+  0x00, 0x04, 0x0C, 0xF2, 0x04, 0x0E, 0xDC, 0xFE, 0xD4, 0x78, 0x0E, 0xD0, 0x02, 0x00, 0x9A, 0x00,
+  0x00, 0x0F, 0xE1, 0x00, 0x07, 0x03, 0x01, 0x00, 0x07, 0x60, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+  0x06, 0xD0, 0x02, 0x04, 0x0E, 0xD0, 0x0C, 0xF6, 0x0E, 0xDC, 0xF6, 0x02, 0xB8, 0x9A, 0xB0, 0x00,
+  0x05, 0x00, 0x05, 0x07, 0x03, 0x00, 0x00, 0x0D, 0xC3, 0x00, 0x05, 0x00, 0x00, 0x03, 0x01, 0x00,
+  0x0C, 0xFE, 0xDC, 0xF6, 0xD0, 0x0E, 0xD4, 0x02, 0x00, 0x96, 0x0C, 0xF6, 0xD4, 0x00, 0x92, 0x00,
+  0x01, 0x00, 0x00, 0x05, 0x00, 0x03, 0x07, 0x05, 0x00, 0x05, 0x00, 0x05, 0x07, 0x00, 0x00, 0x00,
+  0x02, 0x0C, 0xF6, 0x0C, 0xFE, 0xD0, 0x0E, 0xDC, 0xF6, 0xB8, 0x0E, 0xD4, 0x06, 0x0C, 0xF6, 0x00,
+  0x03, 0x00, 0x05, 0x01, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x03, 0x07, 0x05, 0x01, 0x05, 0x00,
+  0x00, 0xF6, 0x0C, 0xF2, 0x0C, 0xFE, 0xDC, 0xF6, 0x0C, 0xFE, 0xD0, 0x06, 0x0C, 0xF2, 0x04, 0x00,
+  0x00, 0x05, 0x00, 0x00, 0x01, 0x00, 0x00, 0x05, 0x01, 0x03, 0x00, 0x05, 0x00, 0x00, 0x07, 0x00,
+  0x06, 0x0C, 0xFE, 0xDC, 0xF2, 0x04, 0x9A, 0x04, 0x02, 0x00, 0x06, 0x0C, 0xF6, 0x0C, 0xF6, 0x00,
+  0x05, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x07, 0x00, 0x01, 0x05, 0x00, 0x05, 0x01, 0x05, 0x00,
+  0x0C, 0xFE, 0xDC, 0xFE, 0xDC, 0xFE, 0xDC, 0xFE, 0xDC, 0xF2, 0x0C, 0xFE, 0xDC, 0xF2, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+const LevelDef levelDefs[5] PROGMEM = {
+  makePackedLevelDef<8, 8>(levelMap1, levelPaths1, 1, 1, 6, 6, 2),
+  makePackedLevelDef<12, 12>(levelMap2, levelPaths2, 1, 1, 10, 10, 6),
+  makePackedLevelDef<16, 16>(levelMap3, levelPaths3, 1, 1, 14, 14, 10),
+  makePackedLevelDef<24, 24>(levelMap4, levelPaths4, 1, 1, 21, 21, 10),
+  makePackedLevelDef<32, 32>(levelMap5, levelPaths5, 1, 1, 29, 29, 10)
+};
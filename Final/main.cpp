@@ -1,11 +1,63 @@
 #include <Arduino.h>
 #include <LiquidCrystal.h>
-#include <LedControl.h>
-#include <EEPROM.h>
 #include <Wire.h>
-#include <Adafruit_MPU6050.h>
-#include <Adafruit_Sensor.h>
 #include <avr/pgmspace.h>
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+#include "matrix_display.h"
+#include "audio_sequencer.h"
+#include "lcd_buffer.h"
+#include "scheduler.h"
+#include "mpu6050_fifo.h"
+#include "joystick_adc.h"
+#include "button_input.h"
+#include "eeprom_queue.h"
+#include "eeprom_journal.h"
+#include "leaderboard.h"
+#include "level_geometry.h"
+#include "level_pack.h"
+#include "maze_gen.h"
+#include "level_analysis.h"
+#include "route_solver.h"
+#include "input_recorder.h"
+
+// Set to 1 to stream every game as a replayable recording over Serial (see
+// input_recorder.h and host/tools/replay.cpp)
+#ifndef RECORD_INPUT
+#define RECORD_INPUT 0
+#endif
+
+// Set to 1 for a matrix wired to the SPI pins (DIN on 11, CLK on 13, LOAD
+// on A3). The default wiring (LOAD 11, CLK 12, DIN 13) is bit-banged
+// through PORTB.
+#ifndef MATRIX_HARDWARE_SPI
+#define MATRIX_HARDWARE_SPI 0
+#endif
+
+// Matrix panel, in 8x8 modules on one MAX7219 chain: 1x1, 2x1 (16x8) or
+// 2x2 (16x16). See MatrixDisplay for the chain order.
+#ifndef MATRIX_MODULES_WIDE
+#define MATRIX_MODULES_WIDE 1
+#endif
+#ifndef MATRIX_MODULES_HIGH
+#define MATRIX_MODULES_HIGH 1
+#endif
+
+// Scan rate of the panel's MAX7219s in Hz: the 500-1300 Hz of the
+// datasheet, 800 typical. Grayscale switches its bit-planes in whole scans
+// (see MatrixDisplay), so set it to what the chips run at, e.g. the
+// frequency on a DIG pin on a scope, when the greys shimmer.
+#ifndef MATRIX_SCAN_HZ
+#define MATRIX_SCAN_HZ 800
+#endif
+
+// Set to 1 to print the CPU cycles one matrix row write takes on each bus
+// (see max7219.h) over Serial at power-up, on the board or under simavr.
+// AVR only.
+#ifndef MATRIX_BENCH
+#define MATRIX_BENCH 0
+#endif
 
 
 // Pins
@@ -18,41 +70,73 @@ const uint8_t PIN_LCD_D7 = 7;
 const uint8_t PIN_LCD_RS = 8;
 const uint8_t PIN_LCD_EN = 9;
 const uint8_t PIN_LCD_BACKLIGHT = 10;
+#if MATRIX_HARDWARE_SPI
+const uint8_t PIN_MATRIX_LOAD = A3;
+const uint8_t PIN_MATRIX_CLK = 13;
+const uint8_t PIN_MATRIX_DIN = 11;
+#else
 const uint8_t PIN_MATRIX_LOAD = 11;
 const uint8_t PIN_MATRIX_CLK = 12;
 const uint8_t PIN_MATRIX_DIN = 13;
+#endif
 const uint8_t PIN_RANDOM_SEED = A0;
 const uint8_t PIN_JOY_X = A1;
 const uint8_t PIN_JOY_Y = A2;
 
-// EEPROM Addresses
-const uint16_t eepromAddressSettingsStart = 0;
+// EEPROM Layout: settings rotate through a journal of CRC-checked records
+// (see eeprom_journal.h), followed by the leaderboard tables (see
+// leaderboard.h): overall first, then one per level
+const uint16_t eepromSettingsJournalStart = 0;
+const uint8_t eepromSettingsSlotSize = 16;
+const uint8_t eepromSettingsSlots = 16;
+const uint16_t eepromLeaderboardStart = 256;
+const uint8_t leaderboardCapacity = 20;
+const uint8_t leaderboardOverall = 0;
+const uint8_t settingsFormatVersion = 1;
+const uint16_t settingsCommitDelay = 2000; // Quiet time before changes are written
+const uint16_t scoresRetryDelay = 20; // Wait for the EEPROM queue to drain about six bytes
+const uint16_t eepromPollPeriod = 4; // Host fallback: one byte per run, AVR uses EE_READY
+
+// Settings record bytes (also the fixed layout used before the journal)
 const uint16_t eepromOffsetLCDBrightness = 0;
 const uint16_t eepromOffsetMatrixBrightness = 1;
 const uint16_t eepromOffsetSound = 2;
 const uint16_t eepromOffsetIMU = 3;
-const uint16_t eepromAddressHighscores = 20; // Start high scores later
+const uint16_t eepromOffsetMazeMode = 4;
+const uint8_t settingsRecordSize = 5;
+
+// Pre-journal fixed addresses, only read to migrate old boards
+const uint16_t eepromAddressSettingsStart = 0;
+const uint16_t eepromAddressHighscores = 20;
+const uint8_t legacyHighScoreCount = 3;
 
 // Game Constants
 const uint8_t maxNameLength = 3;
-const uint8_t highScoreCount = 3;
-const uint8_t totalLevels = 3;
-const uint8_t matrixSize = 8;
-const uint8_t maxLevelEntities = 10;
+const uint8_t totalLevels = 5;
+const uint8_t leaderboardTables = totalLevels + 1;
+const uint8_t matrixWidth = MATRIX_MODULES_WIDE * 8; // Viewport in LEDs
+const uint8_t matrixHeight = MATRIX_MODULES_HIGH * 8;
+const uint8_t matrixModules = MATRIX_MODULES_WIDE * MATRIX_MODULES_HIGH;
+const uint8_t maxLevelDim = 32; // Rows and columns of the largest level
+const uint8_t maxGeneratedLevelDim = 31;
 const uint16_t pointsPerStar = 10;
 const uint16_t baseLevelClearPoints = 6000;
 const uint16_t timeBonusDeduction = 100; // Points lost per second
 const uint8_t minStartDist = 3;
 const uint8_t minExitDist = 2;
+const uint8_t maxLevelStars = 10; // Most stars the par route is worked out for
+const uint32_t routeSearchBudget = 20000; // Par search nodes per level (see route_bench)
+const uint8_t routeSliceNodes = 4; // Par search nodes per game tick, about 1 ms on the board at worst
 
 // Input Constants
-const uint16_t joyCenterMin = 400;
-const uint16_t joyCenterMax = 600;
-const uint32_t debounceDelay = 50;
+const uint16_t debounceDelay = 50;
+const uint16_t backToMenuDelay = 500; // Long press
 const uint32_t moveCooldown = 200;
 const uint32_t menuMoveCooldown = 250;
-const int16_t imuTiltThreshold = 3;
-const uint32_t imuReadInterval = 100;
+// 3 m/s^2 in raw counts: 3 / 9.81 * 4096 counts per g at +-8 g
+const uint16_t imuTiltThreshold = 1253;
+const uint16_t imuReadInterval = 100; // FIFO drained once per interval
+const uint8_t imuSampleRateHz = 50;
 // const uint32_t imuReinitializeInterval = 20000;
 uint32_t imuRunningTime = 0;
 
@@ -60,13 +144,6 @@ uint32_t imuRunningTime = 0;
 const uint8_t brightnessMinUser = 1;
 const uint8_t brightnessMaxUser = 10;
 
-// Entity Types
-const uint8_t ENTITY_EMPTY = 0;
-const uint8_t ENTITY_PLAYER = 1;
-const uint8_t ENTITY_EXIT = 2;
-const uint8_t ENTITY_STAR = 3;
-const uint8_t ENTITY_WALL = 4;
-
 // Directions
 const uint8_t DIR_NONE = 0;
 const uint8_t DIR_UP = 1;
@@ -84,6 +161,7 @@ enum GameState {
   STATE_MENU_SETTINGS_MATRIX,
   STATE_MENU_SETTINGS_SOUND,
   STATE_MENU_SETTINGS_IMU,
+  STATE_MENU_SETTINGS_MAZE,
   STATE_MENU_SETTINGS_RESET_SCORES,
   STATE_MENU_SETTINGS_BACK,
   STATE_MENU_ABOUT,
@@ -110,32 +188,55 @@ enum SettingsOption {
   SET_MATRIX_BRIGHT,
   SET_SOUND,
   SET_IMU,
+  SET_MAZE,
   SET_RESET,
   SETTINGS_COUNT
 };
 
 // Data Structs
-struct HighScoreEntry {
+struct HighScoreEntry { // Pre-journal format, only read to migrate
   char name[maxNameLength + 1]; // +1 for null terminator
   uint16_t score;
 };
 
-struct ToneSequence {
-  uint16_t frequency;
-  uint16_t duration;
-};
-
-struct Entity {
-  uint8_t col;
-  uint8_t row;
-  uint8_t type;
+// One entry per level, kept in PROGMEM. isWall/renderViewport point at the
+// LevelGeometry instantiation matching the level's size.
+struct LevelDef {
+  const void* rows; // Tile map for built-in levels (level_pack.h), row array for generated ones
+  const uint8_t* paths; // Baked path table (level_pack.h), nullptr for generated levels
+  uint8_t width;
+  uint8_t height;
+  uint8_t startCol;
+  uint8_t startRow;
+  uint8_t exitCol;
+  uint8_t exitRow;
+  uint8_t starCount;
+  bool (*isWall)(uint8_t c, uint8_t r);
+  void (*renderViewport)();
+  uint8_t (*placeStars)(uint8_t count); // Returns how many fit
+  bool (*takeStar)(uint8_t c, uint8_t r); // Clears the star at (c, r) if there is one
+  uint8_t (*routeDistances)(uint16_t* dist, uint8_t maxStars); // Par route distances (route_solver.h), returns the stars
+  void (*generate)(); // Carves the rows into RAM first, nullptr for built-in levels
 };
 
 
 // Hardware Objects
-LiquidCrystal lcd(PIN_LCD_RS, PIN_LCD_EN, PIN_LCD_D4, PIN_LCD_D5, PIN_LCD_D6, PIN_LCD_D7);
-LedControl lc = LedControl(PIN_MATRIX_DIN, PIN_MATRIX_CLK, PIN_MATRIX_LOAD, 1);
-Adafruit_MPU6050 mpu;
+LiquidCrystal lcdDevice(PIN_LCD_RS, PIN_LCD_EN, PIN_LCD_D4, PIN_LCD_D5, PIN_LCD_D6, PIN_LCD_D7);
+LcdBuffer lcd(lcdDevice); // Handlers draw here, loop() trickles changes out
+static_assert(matrixWidth <= 16 && matrixModules <= MatrixDisplay::maxModules, "matrix panel is at most 16 LEDs wide");
+Max7219 matrixDevice(MATRIX_HARDWARE_SPI ? MAX7219_BUS_SPI : MAX7219_BUS_PORTB, PIN_MATRIX_DIN, PIN_MATRIX_CLK,
+                     PIN_MATRIX_LOAD, matrixModules);
+MatrixDisplay matrix(matrixDevice, MATRIX_MODULES_WIDE, MATRIX_MODULES_HIGH);
+AudioSequencer audio(PIN_BUZZER); // Timer2 plays the tracks on the AVR
+Mpu6050Fifo imu(Wire);
+JoystickAdc joystick(PIN_JOY_X, PIN_JOY_Y);
+ButtonInput button(PIN_JOY_BTN, debounceDelay, backToMenuDelay);
+EepromQueue eeprom; // Every EEPROM access goes through this background writer
+EepromJournal settingsJournal(eeprom, eepromSettingsJournalStart, eepromSettingsSlotSize, eepromSettingsSlots, 'S');
+Leaderboards leaderboards(eeprom, eepromLeaderboardStart, leaderboardTables, leaderboardCapacity);
+#if RECORD_INPUT
+InputRecorder recorder;
+#endif
 
 // Settings
 uint8_t settingLCDBrightnessUser = 10; // 1-10 scale
@@ -146,19 +247,23 @@ uint8_t matrixBrightnessMin = 0;
 uint8_t matrixBrightnessMax = 15;
 bool settingSoundEnabled = true;
 bool settingIMUEnabled = false;
+bool settingRandomMazes = false;
 bool imuHardwareAvailable = false;
+int8_t imuTiltCol = 0; // Latest classified tilt, -1/0/1 per axis
+int8_t imuTiltRow = 0;
 
 // Input State
 uint16_t joyXVal = 512;
 uint16_t joyYVal = 512;
+int8_t joyXDir = 0; // -1/0/1 against the calibrated center and dead zone
+int8_t joyYDir = 0;
 bool btnPressed = false;
+bool btnLongPressed = false;
 bool btnJustPressed = false;
-bool lastBtnState = HIGH;
-uint32_t lastDebounceTime = 0;
 uint32_t lastInputMoveTime = 0; // For menu navigation rate limiting
-uint32_t backToMenuDelay = 500;
 uint32_t backToMenuIssuedTime = 0;
 uint32_t LCDupdateInteval = 500;
+uint16_t lcdFlushBudgetMicros = 500; // LCD time allowed per loop() pass
 // Game State
 GameState currentState = STATE_INTRO;
 MainMenuOption selectedMainMenu = OPT_START;
@@ -173,96 +278,315 @@ uint16_t currentScore = 0;
 uint8_t currentLevelIndex = 0;
 uint32_t levelStartTime = 0;
 uint32_t lastGameMoveTime = 0; // For player movement cooldown
-uint8_t maxAttempts = 100;
+// Game rules run on their own clock, one gameTickPeriod per game tick, and
+// on the RNG seeded once per game, so a seed plus the tick inputs replay a
+// game exactly
+uint32_t gameClock = 0;
+uint32_t gameSeed = 0;
+uint32_t lastPauseMoveTime = 0;
 
 // Level Data (Loaded from PROGMEM to RAM for current level)
-const uint16_t * currentLevelRows;
-uint8_t currentLevelDim = 8;
+LevelDef currentLevel;
+LevelGeometry<32, 32>::Row generatedLevelRows[maxGeneratedLevelDim]; // Procedural mode only
 uint8_t currentLevelStarsTotal = 0;
 uint8_t currentLevelStarsCollected = 0;
-uint8_t currentLevelStartCol = 0;
-uint8_t currentLevelStartRow = 0;
-uint8_t currentLevelExitCol = 0;
-uint8_t currentLevelExitRow = 0;
-Entity currentEntities[maxLevelEntities];
-uint8_t currentEntityCount = 0;
-
-// High Scores
-HighScoreEntry highScores[highScoreCount];
+// Star index: one bit per cell, same row type and layout as the level rows
+// (cast per geometry like generatedLevelRows)
+LevelGeometry<maxLevelDim, maxLevelDim>::Row currentStarRows[maxLevelDim];
+
+// High Scores (the tables themselves stay in the EEPROM)
+uint16_t levelScores[totalLevels]; // Points earned on each level this game
+uint16_t levelStartScore = 0;
+uint16_t levelParDist[routeDistanceCount(maxLevelStars + 2)]; // The current level's route distances
+RouteSearch levelParSearch; // Fewest moves that clear the current level, worked out as it is played
+uint32_t gameParMillis = 0; // Par and actual time of the levels cleared so far
+uint32_t gameClearMillis = 0;
+bool gameParKnown = true; // false once a level had no route to work out par from
+bool gameParExact = true; // false once a level was cleared before its par search was over
+uint8_t leaderboardTable = leaderboardOverall; // Leaderboard screen position
+uint8_t leaderboardPage = 0;
+const uint8_t leaderboardPageLines = 2;
 char inputNameBuffer[maxNameLength + 1] = "AAA"; // For name entry
-
-// Audio State
-bool audioPlaying = false;
-const ToneSequence* audioSequence = nullptr;
-uint8_t audioTotalTones = 0;
-uint8_t audioCurrentToneIndex = 0;
-uint32_t audioToneStartTime = 0;
-uint32_t audioToneDuration = 0;
+// A finished game's leaderboard entries still to insert: bit t for table t
+uint8_t pendingScoreTables = 0;
+uint16_t pendingScores[leaderboardTables];
+char pendingScoreName[maxNameLength + 1];
 
 // Display Buffers & Timers
-uint8_t matrixBuffer[matrixSize];
-uint32_t lastStarDisplayBlinkTime = 0;
-uint32_t starBlinkPeriod = 300;
-uint32_t playerBlinkPeriod = 150;
-uint32_t lastPlayerDisplayBlinkTime = 0;
+// Frame rows for MatrixDisplay: the dim and the bright plane
+uint8_t matrixPlanes[2][matrixHeight * MATRIX_MODULES_WIDE];
+const uint16_t starBlinkPeriod = 300;
+const uint16_t playerBlinkPeriod = 150;
 bool blinkStateStar = false;
 bool blinkStatePlayer = false;
+bool viewportDirty = true; // Set by whatever changes the game viewport, cleared by renderFrame()
+
+// Scheduler. Each subsystem is a row in the task table; loop() runs only
+// the rows that are due. tickNow is millis() sampled once per pass, so
+// handlers use it instead of calling millis() themselves.
+const uint16_t gameTickPeriod = 5; // Input sampling + state machine
+// gameClock only advances by ticks, so a stall (an EEPROM write backlog, a
+// slow frame) is made up by running the missed ticks back to back, up to
+// this many; the viewport just drops the frames it missed
+const uint8_t gameCatchUpTicks = 20;
+// How often a held direction moves: the first tick past moveCooldown
+const uint32_t moveRepeatMillis = (moveCooldown / gameTickPeriod + 1) * gameTickPeriod;
+// The game viewport is drawn by its own task, at most renderRateCap times a
+// second and only when a tick or a blink phase changed it
+const uint8_t renderRateCap = 60; // Hz
+const uint16_t renderPeriod = (1000 + renderRateCap - 1) / renderRateCap;
+const uint16_t lcdFlushPeriod = 2;
+const uint16_t recordDrainPeriod = 10; // 64-byte Serial buffer, 115200 baud
+uint32_t tickNow = 0;
+RateMeter gameTickRate = {}; // Measured game ticks and viewport frames per second
+RateMeter renderFrameRate = {};
+
+enum TaskId {
+  TASK_GAME,
+  TASK_AUDIO, // Deadline task for the host's note changes; Timer2 does them on the AVR
+  TASK_BLINK_STAR,
+  TASK_BLINK_PLAYER,
+  TASK_RENDER, // After the tasks that change the viewport
+  TASK_LCD,
+  TASK_IMU,
+  TASK_SAVE_SETTINGS, // Deadline task, pushed back by every settings change
+  TASK_SAVE_SCORES, // Deadline task, re-armed until every pending entry is in
+  TASK_EEPROM,
+  TASK_RECORD, // Only runs with RECORD_INPUT
+  TASK_COUNT
+};
 
-const uint16_t level1Data[16] PROGMEM = {
-  0b1111111100000000,
-  0b1000000100000000,
-  0b1110000100000000,
-  0b1000111100000000,
-  0b1110000100000000,
-  0b1000111100000000,
-  0b1000000100000000,
-  0b1111111100000000,
-  0,
-  0,
-  0,
-  0,
-  0,
-  0,
-  0,
-  0
+void updateGame();
+void updateAudio();
+void toggleStarBlink();
+void togglePlayerBlink();
+void renderFrame();
+void flushLcd();
+void updateImu();
+void saveSettings();
+void saveScores();
+void pollEeprom();
+void drainRecording();
+
+// Function, period, catch-up; the scheduler arms the rest and the stats
+// start at 0
+Task tasks[TASK_COUNT] = {
+  { updateGame, gameTickPeriod, gameCatchUpTicks, 0, false, 0, 0, 0, 0 },
+  { updateAudio, 0, 0, 0, false, 0, 0, 0, 0 },
+  { toggleStarBlink, starBlinkPeriod, 0, 0, false, 0, 0, 0, 0 },
+  { togglePlayerBlink, playerBlinkPeriod, 0, 0, false, 0, 0, 0, 0 },
+  { renderFrame, renderPeriod, 0, 0, false, 0, 0, 0, 0 },
+  { flushLcd, lcdFlushPeriod, 0, 0, false, 0, 0, 0, 0 },
+  { updateImu, imuReadInterval, 0, 0, false, 0, 0, 0, 0 },
+  { saveSettings, 0, 0, 0, false, 0, 0, 0, 0 },
+  { saveScores, 0, 0, 0, false, 0, 0, 0, 0 },
+  { pollEeprom, eepromPollPeriod, 0, 0, false, 0, 0, 0, 0 },
+  { drainRecording, RECORD_INPUT ? recordDrainPeriod : 0, 0, 0, false, 0, 0, 0, 0 }
 };
+TaskScheduler scheduler(tasks, TASK_COUNT);
 
-const uint16_t level2Data[16] PROGMEM = {
-  0b1111111111110000,
-  0b1000000001110000,
-  0b1111000001110000,
-  0b1000000111110000,
-  0b1001100000010000,
-  0b1001100011110000,
-  0b1000000000010000,
-  0b1001111100010000,
-  0b1001111100010000,
-  0b1001111100010000,
-  0b1000000000010000,
-  0b1111111111110000,
-  0,
-  0,
-  0,
-  0
+struct RandomRange {
+  uint16_t operator()(uint16_t n) { return random(n); }
 };
 
-const uint16_t level3Data[16] PROGMEM = {
-  0b1111111111111111,
-  0b1000001111100001,
-  0b1000000000000001,
-  0b1011111000110001,
-  0b1000000000110001,
-  0b1000001111110001,
-  0b1011111111110001,
-  0b1011111111110001,
-  0b1000001111000001,
-  0b1001111100000001,
-  0b1001111101111001,
-  0b1001111101110001,
-  0b1000000001110001,
-  0b1011110001110001,
-  0b1000000000000001,
-  0b1111111111111111
+template <typename Row>
+void addStarIn(uint8_t c, uint8_t r) {
+  ((Row*)currentStarRows)[r] |= levelColumnMask<Row>(c);
+}
+
+template <uint8_t W, uint8_t H>
+bool takeStarIn(uint8_t c, uint8_t r) {
+  typedef LevelGeometry<W, H> Geometry;
+  typedef typename Geometry::Row Row;
+  static_assert(H <= maxLevelDim && sizeof(Row) <= sizeof(currentStarRows[0]),
+                "level does not fit the star index");
+  if (!Geometry::inBounds(c, r)) return false;
+  Row* stars = (Row*)currentStarRows;
+  Row mask = levelColumnMask<Row>(c);
+  if (!(stars[r] & mask)) return false;
+  stars[r] &= (Row)~mask;
+  return true;
+}
+
+template <uint8_t W, uint8_t H, typename Source>
+bool isWallIn(uint8_t c, uint8_t r) {
+  return LevelGeometry<W, H, Source>::isWall(currentLevel.rows, c, r);
+}
+
+template <uint8_t W, uint8_t H, typename Source>
+void renderViewportIn() {
+  typedef LevelGeometry<W, H, Source> Geometry;
+  typedef typename Geometry::Row Row;
+
+  // Calculate viewport offset to center player
+  uint8_t colOffset = Geometry::viewportColOffset(playerCol, matrixWidth);
+  uint8_t rowOffset = Geometry::viewportRowOffset(playerRow, matrixHeight);
+
+  // Entities become level-row masks per viewport row, so each matrix row is
+  // a single OR + shift of the level row instead of a per-cell walk. The star
+  // index already has that layout and is copied row for row.
+  //
+  // Walls are on the dim plane, stars and the exit on the bright one and
+  // the player on both, so with grayscale they are three levels and nothing
+  // needs to blink but an open exit. Without it the planes are just OR-ed.
+  bool steady = matrix.grayscale();
+  Row dim[matrixHeight];
+  Row bright[matrixHeight];
+  uint8_t visibleRows = H < matrixHeight ? H : matrixHeight;
+  memset(dim, 0, sizeof(dim));
+  memset(bright, 0, sizeof(bright));
+
+  if (steady || blinkStateStar) memcpy(bright, (const Row*)currentStarRows + rowOffset, visibleRows * sizeof(Row));
+
+  uint8_t exitRow = currentLevel.exitRow - rowOffset;
+  if (exitRow < matrixHeight) {
+    bool drawExit = (currentLevelStarsCollected >= currentLevelStarsTotal) ? blinkStateStar : true;
+    if (drawExit) bright[exitRow] |= levelColumnMask<Row>(currentLevel.exitCol);
+  }
+
+  if(steady || blinkStatePlayer) {
+    uint8_t playerR = playerRow - rowOffset;
+    if (playerR < matrixHeight) {
+      dim[playerR] |= levelColumnMask<Row>(playerCol);
+      bright[playerR] |= levelColumnMask<Row>(playerCol);
+    }
+  }
+
+  Geometry::template extract<matrixWidth, matrixHeight>(currentLevel.rows, colOffset, rowOffset, dim,
+                                                        matrixPlanes[0]);
+  Geometry::template extract<matrixWidth, matrixHeight>(nullptr, colOffset, rowOffset, bright,
+                                                        matrixPlanes[1]);
+}
+
+template <uint8_t W, uint8_t H, typename Source>
+uint8_t placeStarsIn(uint8_t count) {
+  typedef LevelGeometry<W, H, Source> Geometry;
+  typedef typename Geometry::Row Row;
+  Row valid[H];
+  findStarCells<Geometry>(currentLevel.rows,
+                          currentLevel.startCol, currentLevel.startRow,
+                          currentLevel.exitCol, currentLevel.exitRow,
+                          minStartDist, minExitDist, valid);
+  RandomRange rng;
+  return sampleCells<Geometry>(valid, count, rng, addStarIn<Row>);
+}
+
+// Distances between the start, the stars placed (row-major, at most
+// maxStars of them) and the exit, for the route solver. On a built-in level
+// the ones to the exit come from walking the baked next hops, so the floods
+// only have to find the stars.
+template <uint8_t W, uint8_t H, typename Source>
+uint8_t routeDistancesIn(uint16_t* dist, uint8_t maxStars) {
+  typedef LevelGeometry<W, H, Source> Geometry;
+  typedef typename Geometry::Row Row;
+  uint8_t cols[routeMaxStars + 2];
+  uint8_t rows[routeMaxStars + 2];
+  if (maxStars > routeMaxStars) maxStars = routeMaxStars;
+  uint8_t points = 0;
+  cols[points] = currentLevel.startCol;
+  rows[points++] = currentLevel.startRow;
+  const Row* stars = (const Row*)currentStarRows;
+  for (uint8_t r = 0; r < H; r++) {
+    for (uint8_t c = 0; stars[r] && c < W && points <= maxStars; c++) {
+      if (!(stars[r] & levelColumnMask<Row>(c))) continue;
+      cols[points] = c;
+      rows[points++] = r;
+    }
+  }
+  uint8_t placed = points - 1;
+  if (!currentLevel.paths) {
+    cols[points] = currentLevel.exitCol;
+    rows[points++] = currentLevel.exitRow;
+    routeDistances<Geometry>(currentLevel.rows, cols, rows, points, dist);
+    return placed;
+  }
+  routeDistances<Geometry>(currentLevel.rows, cols, rows, points, dist);
+  for (uint8_t i = 0; i < points; i++) {
+    dist[routePairIndex(i, points)] = levelExitDistance(currentLevel.paths, W, cols[i], rows[i], currentLevel.exitCol,
+                                                        currentLevel.exitRow, (uint16_t)W * H);
+  }
+  return placed;
+}
+
+// Same cells as placeStarsIn(), but the exit side comes from the baked
+// path table instead of a flood over the whole level: a star cell must be
+// an open cell at least minExitDist from the exit (every open cell of a
+// built-in level is connected to the exit, and so to the start). A layer of
+// minExitDist or more already says so; a lower one is the distance or 4
+// more, which a few next hops tell apart. Only the few layers around the
+// start are still searched.
+template <uint8_t W, uint8_t H>
+uint8_t placePackedStarsIn(uint8_t count) {
+  typedef LevelGeometry<W, H, TiledRows> Geometry;
+  typedef typename Geometry::Row Row;
+  static_assert(minExitDist <= levelPathLayers, "path table layers cannot tell minExitDist");
+  const uint8_t* paths = currentLevel.paths;
+  Row valid[H];
+  for (uint8_t r = 0; r < H; r++) {
+    Row open = (Row)~Geometry::readRow(currentLevel.rows, r);
+    valid[r] = 0;
+    for (uint8_t c = 0; c < W; c++) {
+      if (!(open & levelColumnMask<Row>(c))) continue;
+      if (levelExitLayer(paths, W, c, r) >= minExitDist ||
+          levelExitDistance(paths, W, c, r, currentLevel.exitCol, currentLevel.exitRow, minExitDist) >= minExitDist) {
+        valid[r] |= levelColumnMask<Row>(c);
+      }
+    }
+  }
+
+  Row nearStart[H];
+  Row frontier[H];
+  floodSeed<Geometry>(nearStart, frontier, currentLevel.startCol, currentLevel.startRow);
+  for (uint8_t d = 1; d < minStartDist && floodStep<Geometry>(currentLevel.rows, nearStart, frontier); d++);
+  for (uint8_t r = 0; r < H; r++) valid[r] &= (Row)~nearStart[r];
+
+  RandomRange rng;
+  return sampleCells<Geometry>(valid, count, rng, addStarIn<Row>);
+}
+
+// Checks the tile map and path table match the declared size at compile
+// time. Every distinct level size instantiates the level templates once.
+template <uint8_t W, uint8_t H, size_t MapSize, size_t PathsSize>
+constexpr LevelDef makePackedLevelDef(const uint8_t (&map)[MapSize], const uint8_t (&paths)[PathsSize],
+                                      uint8_t startCol, uint8_t startRow,
+                                      uint8_t exitCol, uint8_t exitRow, uint8_t starCount) {
+  static_assert(MapSize == ((W + levelTileSize - 1) / levelTileSize) * ((H + levelTileSize - 1) / levelTileSize),
+                "tile map does not match the level size");
+  static_assert(PathsSize == (W + 1) / 2 * H, "path table does not match the level size");
+  return LevelDef{ map, paths, W, H, startCol, startRow, exitCol, exitRow, starCount,
+                   isWallIn<W, H, TiledRows>, renderViewportIn<W, H, TiledRows>,
+                   placePackedStarsIn<W, H>, takeStarIn<W, H>, routeDistancesIn<W, H, TiledRows>, nullptr };
+}
+
+template <uint8_t W, uint8_t H>
+void generateLevelIn() {
+  typedef typename LevelGeometry<W, H, RamRows>::Row Row;
+  static_assert(H <= maxGeneratedLevelDim && sizeof(Row) <= sizeof(generatedLevelRows[0]),
+                "generated level does not fit generatedLevelRows");
+  // Bounded path stack, 2 bits per room
+  uint8_t stack[mazeStackBytes(W, H)];
+  RandomRange rng;
+  generateMaze((Row*)generatedLevelRows, 1, W, H, stack, sizeof(stack), rng);
+}
+
+// Odd sizes so the start (1, 1) and exit (W-2, H-2) land on rooms
+template <uint8_t W, uint8_t H>
+constexpr LevelDef makeGeneratedLevelDef(uint8_t starCount) {
+  return LevelDef{ generatedLevelRows, nullptr, W, H, 1, 1, W - 2, H - 2, starCount,
+                   isWallIn<W, H, RamRows>, renderViewportIn<W, H, RamRows>, placeStarsIn<W, H, RamRows>,
+                   takeStarIn<W, H>, routeDistancesIn<W, H, RamRows>, generateLevelIn<W, H> };
+}
+
+// Built-in levels: levelTiles, the tile maps and path tables, and levelDefs
+#include "level_pack_data.h"
+static_assert(sizeof(levelDefs) / sizeof(levelDefs[0]) == totalLevels, "level pack does not match totalLevels");
+
+const LevelDef generatedLevelDefs[totalLevels] PROGMEM = {
+  makeGeneratedLevelDef<9, 9>(2),
+  makeGeneratedLevelDef<13, 13>(6),
+  makeGeneratedLevelDef<17, 17>(10),
+  makeGeneratedLevelDef<25, 25>(10),
+  makeGeneratedLevelDef<31, 31>(10)
 };
 
 const ToneSequence seqMenuMove[] PROGMEM = { {800, 50} };
@@ -271,6 +595,11 @@ const ToneSequence seqCollectStar[] PROGMEM = { {1000, 80}, {1200, 80} };
 const ToneSequence seqLevelComplete[] PROGMEM = { {1000, 100}, {1200, 100}, {1500, 100}, {2000, 200} };
 const ToneSequence seqVictory[] PROGMEM = { {1500, 100}, {1800, 100}, {2100, 100}, {2500, 300} };
 const ToneSequence seqStartup[] PROGMEM = { {1000, 200}, {1500, 200}, {2000, 200} };
+// Loops on the music channel while a game is on; effects play over it
+const ToneSequence trackTheme[] PROGMEM = {
+  {440, 150}, {0, 50}, {523, 150}, {0, 50}, {659, 150}, {0, 50}, {523, 150}, {0, 250},
+  {392, 150}, {0, 50}, {494, 150}, {0, 50}, {587, 150}, {0, 50}, {494, 150}, {0, 250}
+};
 
 
 const uint8_t iconPlay[8] = {
@@ -327,266 +656,225 @@ void applyLCDBrightness() {
   // Map 1-10 to PWM (approx 25 to 255)
   uint8_t pwmVal = map(settingLCDBrightnessUser, brightnessMinUser, brightnessMaxUser, lcdPWMOutputMin, lcdPWMOutputMax);
   analogWrite(PIN_LCD_BACKLIGHT, pwmVal);
+#if defined(__AVR__)
+  // The matrix refresh has Timer1 counting to ICR1 rather than 255
+  if (matrix.grayscale() && pwmVal < 255) OCR1B = (uint32_t)pwmVal * ICR1 / 255;
+#endif
 }
 
 void applyMatrixBrightness() {
   // Map 1-10 to 0-15
   uint8_t hwVal = map(settingMatrixBrightnessUser, brightnessMinUser, brightnessMaxUser, matrixBrightnessMin, matrixBrightnessMax);
-  lc.setIntensity(0, hwVal);
+  matrix.setIntensity(hwVal);
 }
 
 void playSoundSequence(const ToneSequence* seq, uint8_t count) {
   if (!settingSoundEnabled) return;
-  // Stop current
-  noTone(PIN_BUZZER);
-  audioPlaying = true;
-  audioSequence = seq;
-  audioTotalTones = count;
-  audioCurrentToneIndex = 0;
-  
-  // Play first
-  uint16_t freq = pgm_read_word(&(seq[0].frequency));
-  uint16_t dur = pgm_read_word(&(seq[0].duration));
-  tone(PIN_BUZZER, freq, dur);
-  audioToneStartTime = millis();
-  audioToneDuration = dur;
+  audio.play(AUDIO_SFX, seq, count);
+  updateAudio();
+}
+
+// The theme plays while a game is on and stops for the pause menu
+void updateMusic() {
+  bool wanted = settingSoundEnabled && currentState == STATE_GAME_PLAYING;
+  if (wanted == audio.playing(AUDIO_MUSIC)) return;
+  if (wanted) audio.play(AUDIO_MUSIC, trackTheme, sizeof(trackTheme) / sizeof(ToneSequence), true);
+  else audio.stop(AUDIO_MUSIC);
+  updateAudio();
 }
 
 void updateAudio() {
-  if (!audioPlaying || !settingSoundEnabled) return;
-  
-  if (millis() - audioToneStartTime >= audioToneDuration) {
-    audioCurrentToneIndex++;
-    if (audioCurrentToneIndex >= audioTotalTones) {
-      audioPlaying = false;
-      noTone(PIN_BUZZER);
-    } else {
-      uint16_t freq = pgm_read_word(&(audioSequence[audioCurrentToneIndex].frequency));
-      uint16_t dur = pgm_read_word(&(audioSequence[audioCurrentToneIndex].duration));
-      tone(PIN_BUZZER, freq, dur);
-      audioToneStartTime = millis();
-      audioToneDuration = dur;
-    }
+  uint16_t next = audio.poll();
+  if (next) scheduler.wake(TASK_AUDIO, tickNow + next);
+}
+
+void applySettingsRecord(const uint8_t* record) {
+  settingLCDBrightnessUser = constrain(record[eepromOffsetLCDBrightness], brightnessMinUser, brightnessMaxUser);
+  settingMatrixBrightnessUser = constrain(record[eepromOffsetMatrixBrightness], brightnessMinUser, brightnessMaxUser);
+  settingSoundEnabled = (record[eepromOffsetSound] == 1);
+  settingIMUEnabled = (record[eepromOffsetIMU] == 1);
+  settingRandomMazes = (record[eepromOffsetMazeMode] == 1);
+}
+
+// The top three older firmware kept at fixed addresses go into the overall
+// table, once: loadSettings() calls this only while there is no settings
+// journal yet, and before the journal's slots write over them
+void importLegacyHighScores() {
+  static_assert(sizeof(HighScoreEntry) == 6, "HighScoreEntry must match the old layout");
+  HighScoreEntry legacy[legacyHighScoreCount];
+  eeprom.read(eepromAddressHighscores, legacy, sizeof(legacy));
+  for (uint8_t i = 0; i < legacyHighScoreCount; i++) {
+    // Never written
+    if (legacy[i].score == 0 || legacy[i].score == 0xFFFF) continue;
+    leaderboards.insert(leaderboardOverall, legacy[i].score, legacy[i].name);
   }
 }
 
 void loadSettings() {
-  uint8_t val = EEPROM.read(eepromAddressSettingsStart + eepromOffsetLCDBrightness);
-  settingLCDBrightnessUser = constrain(val, brightnessMinUser, brightnessMaxUser);
-  
-  val = EEPROM.read(eepromAddressSettingsStart + eepromOffsetMatrixBrightness);
-  settingMatrixBrightnessUser = constrain(val, brightnessMinUser, brightnessMaxUser);
-  
-  val = EEPROM.read(eepromAddressSettingsStart + eepromOffsetSound);
-  settingSoundEnabled = (val == 1);
-
-  val = EEPROM.read(eepromAddressSettingsStart + eepromOffsetIMU);
-  settingIMUEnabled = (val == 1);
+  uint8_t record[settingsRecordSize];
+  uint8_t version = settingsJournal.load(record, sizeof(record));
+  if (version == settingsFormatVersion) {
+    applySettingsRecord(record);
+  } else if (version == 0) {
+    // No journal yet: take over the fixed bytes older firmware wrote
+    // (erased cells clamp to the defaults) and start the journal with them
+    eeprom.read(eepromAddressSettingsStart, record, sizeof(record));
+    applySettingsRecord(record);
+    importLegacyHighScores();
+    saveSettings();
+  }
+  // A newer format is left alone for the firmware that wrote it
 }
 
 void saveSettings() {
-  EEPROM.update(eepromAddressSettingsStart + eepromOffsetLCDBrightness, settingLCDBrightnessUser);
-  EEPROM.update(eepromAddressSettingsStart + eepromOffsetMatrixBrightness, settingMatrixBrightnessUser);
-  EEPROM.update(eepromAddressSettingsStart + eepromOffsetSound, settingSoundEnabled ? 1 : 0);
-  EEPROM.update(eepromAddressSettingsStart + eepromOffsetIMU, settingIMUEnabled ? 1 : 0);
+  uint8_t record[settingsRecordSize];
+  record[eepromOffsetLCDBrightness] = settingLCDBrightnessUser;
+  record[eepromOffsetMatrixBrightness] = settingMatrixBrightnessUser;
+  record[eepromOffsetSound] = settingSoundEnabled ? 1 : 0;
+  record[eepromOffsetIMU] = settingIMUEnabled ? 1 : 0;
+  record[eepromOffsetMazeMode] = settingRandomMazes ? 1 : 0;
+  settingsJournal.commit(record, sizeof(record), settingsFormatVersion);
 }
 
-void loadHighScores() {
-  uint16_t addr = eepromAddressHighscores;
-  for (uint8_t i = 0; i < highScoreCount; i++) {
-    EEPROM.get(addr, highScores[i]);
-    // Validate characters
-    for(uint8_t c = 0; c < maxNameLength; c++) {
-      if(highScores[i].name[c] < 'A' || highScores[i].name[c] > 'Z' && highScores[i].score != 0) highScores[i].name[c] = '-';
-    }
-    highScores[i].name[maxNameLength] = '\0';
-    addr += sizeof(HighScoreEntry);
-  }
+// Coalesces a burst of changes (e.g. holding the brightness slider) into a
+// single journal record once the settings have been quiet for a while
+void requestSettingsSave() {
+  scheduler.wake(TASK_SAVE_SETTINGS, tickNow + settingsCommitDelay);
 }
 
-void saveHighScores() {
-  uint16_t addr = eepromAddressHighscores;
-  for (uint8_t i = 0; i < highScoreCount; i++) {
-    EEPROM.put(addr, highScores[i]);
-    addr += sizeof(HighScoreEntry);
-  }
+// A table a reset tore in the middle of an insert gets it finished, an
+// erased or foreign one comes back empty
+void loadHighScores() {
+  static_assert(eepromLeaderboardStart + leaderboardTables * Leaderboards::tableSize(leaderboardCapacity) <= 1024,
+                "leaderboards do not fit the EEPROM");
+  leaderboards.check();
 }
 
 void resetHighScores() {
-  for (uint8_t i = 0; i < highScoreCount; i++) {
-    strcpy(highScores[i].name, "---");
-    highScores[i].score = 0;
-  }
-  saveHighScores();
+  pendingScoreTables = 0;
+  for (uint8_t t = 0; t < leaderboardTables; t++) leaderboards.clear(t);
+  // The user confirmed a destructive action: make sure it sticks before
+  // saying so
+  eeprom.flush();
 }
 
 void readInputs() {
-  joyXVal = analogRead(PIN_JOY_X);
-  joyYVal = analogRead(PIN_JOY_Y);
-  
-  bool reading = (digitalRead(PIN_JOY_BTN) == LOW);
-  if (reading != lastBtnState) {
-    lastDebounceTime = millis();
-  }
+  // Latest background sample, no ADC wait
+  joystick.update();
+  joyXVal = joystick.value(0);
+  joyYVal = joystick.value(1);
+  joyXDir = joystick.direction(0);
+  joyYDir = joystick.direction(1);
   
+  // Button edges were captured by the pin 2 interrupt. Hand out at most one
+  // press or long press per tick; anything after it waits for the next one.
   btnJustPressed = false;
-  if ((millis() - lastDebounceTime) > debounceDelay) {
-    if (reading != btnPressed) {
-      btnPressed = reading;
-      if (btnPressed) {
-        btnJustPressed = true;
-      }
+  btnLongPressed = false;
+  ButtonEvent event;
+  while ((event = button.next((uint16_t)tickNow)) != BUTTON_NONE) {
+    if (event == BUTTON_PRESS) {
+      btnJustPressed = true;
+      break;
+    }
+    if (event == BUTTON_LONG_PRESS) {
+      btnLongPressed = true;
+      break;
     }
   }
-  lastBtnState = reading;
+  btnPressed = button.isDown();
 }
 
 bool isWall(uint8_t c, uint8_t r) {
-  if (c >= currentLevelDim || r >= currentLevelDim) return true;
-  
-  // Read row word from PROGMEM
-  uint16_t rowData = pgm_read_word(&(currentLevelRows[r]));
-  // Check bit (MSB is column 0)
-  return (rowData & (1 << (15 - c)));
-}
-
-// Randomly place stars ensuring no collision with walls, start, or exit
-void placeEntities(uint8_t count) {
-  currentEntityCount = 0;
-  uint16_t attempts = 0;
-  while (currentEntityCount < count && attempts < maxAttempts) {
-    attempts++;
-    uint8_t c = random(currentLevelDim);
-    uint8_t r = random(currentLevelDim);
-    
-    // Check Walls
-    if (isWall(c, r)) continue;
-    
-    // Check distances
-    int8_t distStart = abs((int8_t)c - (int8_t)currentLevelStartCol) + abs((int8_t)r - (int8_t)currentLevelStartRow);
-    int8_t distExit = abs((int8_t)c - (int8_t)currentLevelExitCol) + abs((int8_t)r - (int8_t)currentLevelExitRow);
-    
-    if (distStart < minStartDist || distExit < minExitDist) continue;
-    
-    // Check duplicates
-    bool overlap = false;
-    for(uint8_t i=0; i<currentEntityCount; i++) {
-      if(currentEntities[i].col == c && currentEntities[i].row == r) {
-        overlap = true; 
-        break;
-      }
-    }
-    if (overlap) continue;
-    
-    currentEntities[currentEntityCount].col = c;
-    currentEntities[currentEntityCount].row = r;
-    currentEntities[currentEntityCount].type = ENTITY_STAR;
-    currentEntityCount++;
-  }
+  // Bounds are part of the specialized check: outside the level is wall
+  return currentLevel.isWall(c, r);
+}
+
+// Randomly place stars on cells the player can reach, at least minStartDist
+// and minExitDist steps (along the maze) from the start and exit. Every
+// valid cell is equally likely and there are no retries; if the level has
+// fewer valid cells than requested, fewer stars are placed.
+uint8_t placeEntities(uint8_t count) {
+  memset(currentStarRows, 0, sizeof(currentStarRows));
+  return currentLevel.placeStars(count);
+}
+
+// Fewest moves from the start through every star to the exit. The search
+// takes up to a few seconds on the board, so it runs alongside the level,
+// routeSliceNodes nodes per game tick of it so far: no tick waits long for
+// it, and as it is paced by gameClock alone a replay ends it the same way.
+// A level cleared before the search is over (or that defeats its budget)
+// gets the best route found by then, and the game's grade is marked as
+// approximate; one with no route at all gets no grade.
+void beginLevelPar() {
+  uint8_t stars = currentLevel.routeDistances(levelParDist, maxLevelStars);
+  levelParSearch.begin(levelParDist, stars, routeSearchBudget);
+}
+
+void levelParStep() {
+  uint32_t allowed = (gameClock - levelStartTime) / gameTickPeriod * routeSliceNodes;
+  uint32_t visited = levelParSearch.result().nodes;
+  if (allowed > visited) levelParSearch.run(allowed - visited);
 }
 
 void initLevels(uint8_t levelIdx) {
   currentLevelIndex = levelIdx;
   currentLevelStarsCollected = 0;
   
-  if (levelIdx == 0) {
-    currentLevelRows = level1Data;
-    currentLevelDim = 8;
-    currentLevelStarsTotal = 2;
-    currentLevelStartCol = 1;
-    currentLevelStartRow = 1;
-    currentLevelExitCol = 6;
-    currentLevelExitRow = currentLevelDim - 2;
-  } else if (levelIdx == 1) {
-    currentLevelRows = level2Data;
-    currentLevelDim = 12;
-    currentLevelStarsTotal = 6;
-    currentLevelStartCol = 1;
-    currentLevelStartRow = 1;
-    currentLevelExitCol = 10;
-    currentLevelExitRow = currentLevelDim - 2;
-  } else {
-    currentLevelRows = level3Data;
-    currentLevelDim = 16;
-    currentLevelStarsTotal = 10;
-    currentLevelStartCol = 1;
-    currentLevelStartRow = 1;
-    currentLevelExitCol = 14;
-    currentLevelExitRow = currentLevelDim - 2;
-  }
-  
-  playerCol = currentLevelStartCol;
-  playerRow = currentLevelStartRow;
-  placeEntities(currentLevelStarsTotal);
-  levelStartTime = millis();
+  const LevelDef* defs = settingRandomMazes ? generatedLevelDefs : levelDefs;
+  memcpy_P(&currentLevel, &defs[levelIdx], sizeof(LevelDef));
+  if (currentLevel.generate) currentLevel.generate();
+
+  playerCol = currentLevel.startCol;
+  playerRow = currentLevel.startRow;
+  // The level can only be finished with the stars that actually fit
+  currentLevelStarsTotal = placeEntities(currentLevel.starCount);
+  levelStartTime = gameClock;
+  beginLevelPar();
+  levelStartScore = currentScore;
 }
 
-void startGame() {
+// How the rules read the input: IMU control and the maze source. Neither
+// can change during a game.
+uint8_t gameFlags() {
+  uint8_t flags = 0;
+  if (settingIMUEnabled && imuHardwareAvailable) flags |= RECORD_IMU_CONTROL;
+  if (settingRandomMazes) flags |= RECORD_RANDOM_MAZES;
+  return flags;
+}
+
+// Everything a game's outcome depends on starts from here and the seed
+void beginGame(uint32_t seed) {
+  randomSeed(seed);
+  gameClock = 0;
+  lastGameMoveTime = 0;
+  lastPauseMoveTime = 0;
+  pausedSelectedOption = 0;
   currentScore = 0;
+  memset(levelScores, 0, sizeof(levelScores));
+  gameParMillis = 0;
+  gameClearMillis = 0;
+  gameParKnown = true;
+  gameParExact = true;
   initLevels(0);
   currentState = STATE_GAME_PLAYING;
+}
+
+void startGame() {
+  // Drawn from the running RNG, which the seed then replaces
+  gameSeed = random(1, 0x7FFFFFFF);
+  beginGame(gameSeed);
+#if RECORD_INPUT
+  recorder.begin(gameSeed, gameFlags());
+#endif
   lcd.clear();
+  viewportDirty = true;
 }
 
 void updateMatrixViewport() {
-  // Clear local buffer
-  memset(matrixBuffer, 0, matrixSize);
-  
-  // Calculate viewport offset to center player
-  uint8_t colOffset = 0;
-  uint8_t rowOffset = 0;
-  
-  if (currentLevelDim > matrixSize) {
-    colOffset = constrain((uint8_t)playerCol - matrixSize/2, 0, currentLevelDim - matrixSize);
-    rowOffset = constrain((uint8_t)playerRow - matrixSize/2, 0, currentLevelDim - matrixSize);
-  }
-  
-  for(uint8_t r = 0; r < matrixSize; r++) {
-    uint8_t levelR = r + rowOffset;
-    if (levelR < currentLevelDim) {
-      uint16_t rowData = pgm_read_word(&(currentLevelRows[levelR]));
-      for(uint8_t c = 0; c < matrixSize; c++) {
-        uint8_t levelC = c + colOffset;
-        if (levelC < currentLevelDim) {
-           if (rowData & (1 << (15 - levelC))) {
-             matrixBuffer[r] |= (1 << (7 - c));
-           }
-        }
-      }
-    }
-  }
-  
-  if (blinkStateStar) {
-    for(uint8_t i=0; i<currentEntityCount; i++) {
-      if (currentEntities[i].type == ENTITY_STAR) {
-        int8_t starCol = currentEntities[i].col - colOffset;
-        int8_t starRow = currentEntities[i].row - rowOffset;
-        if (starCol >= 0 && starCol < matrixSize && starRow >= 0 && starRow < matrixSize) {
-          matrixBuffer[starRow] |= (1 << (7 - starCol));
-        }
-      }
-    }
-  }
-  
-  int8_t exitCol = currentLevelExitCol - colOffset;
-  int8_t exitRow = currentLevelExitRow - rowOffset;
-  if (exitCol >= 0 && exitCol < matrixSize && exitRow >= 0 && exitRow < matrixSize) {
-    bool drawExit = (currentLevelStarsCollected >= currentLevelStarsTotal) ? blinkStateStar : true;
-    if (drawExit) matrixBuffer[exitRow] |= (1 << (7 - exitCol));
-  }
-  
-  if(blinkStatePlayer) { 
-    int8_t playerC = playerCol - colOffset;
-    int8_t playerR = playerRow - rowOffset;
-    if (playerC >= 0 && playerC < matrixSize && playerR >= 0 && playerR < matrixSize) {
-      matrixBuffer[playerR] |= (1 << (7 - playerC));
-    }
-  }  
+  currentLevel.renderViewport();
 
-  // Push to hardware
-  for(uint8_t i = 0; i < matrixSize; i ++) {
-    lc.setColumn(0, i, matrixBuffer[i]);
-  }
+  // Push to hardware (only rows that changed go out)
+  matrix.drawPlanes(matrixPlanes[0], matrixPlanes[1]);
 }
 
 
@@ -598,8 +886,7 @@ void handleIntro() {
     lcd.setCursor(0, 1); lcd.print(F(" Press Button "));
     
     // Draw Play Icon on Matrix
-    lc.clearDisplay(0);
-    for(uint8_t i = 0; i < matrixSize; i++) lc.setColumn(0, i, iconPlay[i]);
+    matrix.drawIcon(iconPlay);
     
     playSoundSequence(seqStartup, 3);
     drawn = true;
@@ -616,15 +903,15 @@ void handleMainMenu() {
   static bool drawn = false;
   static MainMenuOption lastOpt = MAIN_MENU_COUNT; // force redraw
   
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
-    if (joyYVal < joyCenterMin) {
+  if (tickNow - lastInputMoveTime > menuMoveCooldown) {
+    if (joyYDir < 0) {
       selectedMainMenu = (MainMenuOption)((selectedMainMenu + 1) % MAIN_MENU_COUNT);
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
-    } else if (joyYVal > joyCenterMax) {
+      lastInputMoveTime = tickNow;
+    } else if (joyYDir > 0) {
       selectedMainMenu = (MainMenuOption)((selectedMainMenu - 1 + MAIN_MENU_COUNT) % MAIN_MENU_COUNT);
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
+      lastInputMoveTime = tickNow;
     }
   }
   
@@ -655,13 +942,14 @@ void handleMainMenu() {
         lcd.print(F("How to Play")); 
         icon = iconQuestion; 
         break;
+      case MAIN_MENU_COUNT: // Not an option; listed so -Wswitch catches a missing one
+        break;
     }
     
     lcd.setCursor(0, 1);
     lcd.print(F("Select: Button"));
     
-    lc.clearDisplay(0);
-    for(uint8_t i=0; i < matrixSize; i++) lc.setColumn(0, i, icon[i]);
+    matrix.drawIcon(icon);
     
     lastOpt = selectedMainMenu;
     drawn = true;
@@ -678,6 +966,7 @@ void handleMainMenu() {
       case OPT_SETTINGS: currentState = STATE_MENU_SETTINGS; break;
       case OPT_ABOUT: currentState = STATE_MENU_ABOUT; break;
       case OPT_HOWTO: currentState = STATE_MENU_HOWTO; break;
+      case MAIN_MENU_COUNT: break;
     }
   }
 }
@@ -686,15 +975,15 @@ void handleSettingsMenu() {
   static bool drawn = false;
   static SettingsOption lastOpt = SETTINGS_COUNT;
   
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
-    if (joyYVal < joyCenterMin) {
+  if (tickNow - lastInputMoveTime > menuMoveCooldown) {
+    if (joyYDir < 0) {
       selectedSetting = (SettingsOption)((selectedSetting + 1) % SETTINGS_COUNT);
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
-    } else if (joyYVal > joyCenterMax) {
+      lastInputMoveTime = tickNow;
+    } else if (joyYDir > 0) {
       selectedSetting = (SettingsOption)((selectedSetting - 1 + SETTINGS_COUNT) % SETTINGS_COUNT);
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
+      lastInputMoveTime = tickNow;
     }
   }
   
@@ -716,17 +1005,20 @@ void handleSettingsMenu() {
         lcd.print(F("IMU Ctr: "));
         lcd.print(settingIMUEnabled ? F("ON") : F("OFF"));
         break;
+      case SET_MAZE:
+        lcd.print(F("Maze: "));
+        lcd.print(settingRandomMazes ? F("RANDOM") : F("FIXED"));
+        break;
       case SET_RESET: 
         lcd.print(F("Reset Scores"));
         break;
+      case SETTINGS_COUNT: // Not an option; listed so -Wswitch catches a missing one
+        break;
     }
     lcd.setCursor(0, 1);
     lcd.print(F("Back: Hold Btn"));
     
-    lc.clearDisplay(0);
-    for(uint8_t i = 0; i< matrixSize; i ++) {
-      lc.setColumn(0, i, iconSettings[i]);
-    }
+    matrix.drawIcon(iconSettings);
     lastOpt = selectedSetting;
     drawn = true;
   }
@@ -749,9 +1041,14 @@ void handleSettingsMenu() {
       case SET_IMU:
         currentState = STATE_MENU_SETTINGS_IMU;
         break;
+      case SET_MAZE:
+        currentState = STATE_MENU_SETTINGS_MAZE;
+        break;
       case SET_RESET:
         currentState = STATE_MENU_SETTINGS_RESET_SCORES;
         break;
+      case SETTINGS_COUNT:
+        break;
      }
   }
 }
@@ -764,22 +1061,22 @@ void handleSettingsValue(uint8_t type) {
   
   uint8_t* targetVal = (type == 0) ? &settingLCDBrightnessUser : &settingMatrixBrightnessUser;
   
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
+  if (tickNow - lastInputMoveTime > menuMoveCooldown) {
     bool changed = false;
-    if (joyXVal < joyCenterMin && *targetVal > brightnessMinUser) {
+    if (joyXDir < 0 && *targetVal > brightnessMinUser) {
       (*targetVal)--;
       changed = true;
-    } else if (joyXVal > joyCenterMax && *targetVal < brightnessMaxUser) {
+    } else if (joyXDir > 0 && *targetVal < brightnessMaxUser) {
       (*targetVal)++;
       changed = true;
     }
     
     if (changed) {
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
+      lastInputMoveTime = tickNow;
       if (type == SET_LCD_BRIGHT) applyLCDBrightness();
       else applyMatrixBrightness();
-      saveSettings();
+      requestSettingsSave();
     }
   }
   
@@ -805,25 +1102,33 @@ void handleSettingsValue(uint8_t type) {
 }
 
 void handleSettingsToggle(uint8_t type) {
-  // type 0 = Sound, 1 = IMU
+  // type SET_SOUND, SET_IMU or SET_MAZE
   static bool drawn = false;
-  bool * target = (type == SET_SOUND) ? &settingSoundEnabled : &settingIMUEnabled;
+  bool * target = &settingSoundEnabled;
+  if (type == SET_IMU) target = &settingIMUEnabled;
+  else if (type == SET_MAZE) target = &settingRandomMazes;
   
   if (!drawn) {
     lcd.clear();
-    lcd.print(type == SET_SOUND ? F("Sound: ") : F("IMU Control: "));
-    lcd.print(*target ? F("ON") : F("OFF"));
+    if (type == SET_MAZE) {
+      lcd.print(F("Maze: "));
+      lcd.print(*target ? F("RANDOM") : F("FIXED"));
+    } else {
+      lcd.print(type == SET_SOUND ? F("Sound: ") : F("IMU Control: "));
+      lcd.print(*target ? F("ON") : F("OFF"));
+    }
     lcd.setCursor(0, 1);
     lcd.print(F("Move Joy to Flip"));
     drawn = true;
   }
   
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
-    if (joyXVal < joyCenterMin || joyXVal > joyCenterMax) {
+  if (tickNow - lastInputMoveTime > menuMoveCooldown) {
+    if (joyXDir != 0) {
        *target = !(*target);
-       saveSettings();
+       if (!settingSoundEnabled) audio.stopAll();
+       requestSettingsSave();
        playSoundSequence(seqMenuMove, 1);
-       lastInputMoveTime = millis();
+       lastInputMoveTime = tickNow;
        drawn = false; // redraw
     }
   }
@@ -847,11 +1152,11 @@ void handleSettingsReset() {
     drawn = true;
   }
   
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
-    if (joyXVal < joyCenterMin || joyXVal > joyCenterMax) {
+  if (tickNow - lastInputMoveTime > menuMoveCooldown) {
+    if (joyXDir != 0) {
       confirm = !confirm;
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
+      lastInputMoveTime = tickNow;
       drawn = false;
     }
   }
@@ -865,6 +1170,7 @@ void handleSettingsReset() {
       resetHighScores();
       lcd.clear();
       lcd.print(F("Scores Reset!"));
+      while (!lcd.flush(lcdFlushBudgetMicros));
       delay(100);
       currentState = STATE_MENU_SETTINGS;
     }
@@ -880,10 +1186,7 @@ void handleAbout() {
     lcd.print(F("Maze Master v1"));
     lcd.setCursor(0, 1);
     lcd.print(F("By MateiHsn"));
-    lc.clearDisplay(0);
-    for(uint8_t i = 0; i < matrixSize; i++) {
-      lc.setColumn(0, i, iconInfo[i]);
-    }
+    matrix.drawIcon(iconInfo);
     drawn = true;
   }
   if (btnJustPressed) {
@@ -905,17 +1208,16 @@ void handleHowTo() {
     } else {
       lcd.print(settingIMUEnabled ? F("Tilt to Move") : F("Joy to Move"));
     }
-    lc.clearDisplay(0);
-    for(uint8_t i=0; i < matrixSize; i++) lc.setColumn(0, i, iconQuestion[i]);
+    matrix.drawIcon(iconQuestion);
     drawn = true;
   }
   
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
-    if (joyXVal < joyCenterMin || joyXVal > joyCenterMax) {
+  if (tickNow - lastInputMoveTime > menuMoveCooldown) {
+    if (joyXDir != 0) {
       page = !page;
       drawn = false;
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
+      lastInputMoveTime = tickNow;
     }
   }
   
@@ -926,201 +1228,329 @@ void handleHowTo() {
   }
 }
 
+// One leaderboard line: "Lv3 12.ABC 5230", blank past the last entry
+void printLeaderboardLine(uint8_t table, uint8_t rank) {
+  bool empty = rank >= leaderboards.count(table);
+  if (empty && rank > 0) return;
+  if (table == leaderboardOverall) lcd.print(F("All"));
+  else { lcd.print(F("Lv")); lcd.print(table); }
+  lcd.print(' ');
+  if (empty) {
+    lcd.print(F("no scores"));
+    return;
+  }
+  if (rank + 1 < 10) lcd.print(' ');
+  lcd.print(rank + 1); lcd.print('.');
+  LeaderboardRecord record = leaderboards.record(table, rank);
+  char name[Leaderboards::nameLength + 1];
+  Leaderboards::unpackName(record, name);
+  lcd.print(name); lcd.print(' ');
+  lcd.print(Leaderboards::score(record));
+}
+
+// Up/down pages through a table two entries at a time, left/right picks
+// the table. Only the two shown records are read from the EEPROM.
 void handleHighScores() {
-  static uint8_t idx = 0;
   static bool drawn = false;
   
   if (!drawn) {
     lcd.clear();
-    lcd.print(F("High Scores:"));
-    lcd.setCursor(0, 1);
-    lcd.print(idx + 1); lcd.print(F(". "));
-    lcd.print(highScores[idx].name);
-    lcd.print(F(" "));
-    lcd.print(highScores[idx].score);
-    
-    lc.clearDisplay(0);
-    for(uint8_t i=0; i < matrixSize; i++) {
-      lc.setColumn(0, i, iconTrophy[i]);
+    for (uint8_t line = 0; line < leaderboardPageLines; line++) {
+      lcd.setCursor(0, line);
+      printLeaderboardLine(leaderboardTable, leaderboardPage * leaderboardPageLines + line);
     }
+    
+    matrix.drawIcon(iconTrophy);
     drawn = true;
   }
   
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
-    if (joyYVal < joyCenterMin) {
-      idx = (idx - 1 + highScoreCount) % highScoreCount;
-      drawn = false;
-      playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
-    } else if (joyYVal > joyCenterMax) {
-      idx = (idx + 1) % highScoreCount;
+  if (tickNow - lastInputMoveTime > menuMoveCooldown) {
+    bool moved = true;
+    // Pages past the last entry are skipped
+    uint8_t usedPages = (leaderboards.count(leaderboardTable) + leaderboardPageLines - 1) / leaderboardPageLines;
+    if (usedPages == 0) usedPages = 1;
+    if (joyYDir < 0) {
+      leaderboardPage = (leaderboardPage + usedPages - 1) % usedPages;
+    } else if (joyYDir > 0) {
+      leaderboardPage = (leaderboardPage + 1) % usedPages;
+    } else if (joyXDir < 0) {
+      leaderboardTable = (leaderboardTable + leaderboardTables - 1) % leaderboardTables;
+      leaderboardPage = 0;
+    } else if (joyXDir > 0) {
+      leaderboardTable = (leaderboardTable + 1) % leaderboardTables;
+      leaderboardPage = 0;
+    } else {
+      moved = false;
+    }
+    if (moved) {
       drawn = false;
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
+      lastInputMoveTime = tickNow;
     }
   }
   
   if (btnJustPressed) {
     currentState = STATE_MENU_MAIN;
     drawn = false;
-    idx = 0;
+    leaderboardTable = leaderboardOverall;
+    leaderboardPage = 0;
   }
 }
 
-void handleGamePlay() {
-  // 1. Movement Logic
-  if (millis() - lastGameMoveTime > moveCooldown) {
-    int8_t deltaCol = 0;
-    int8_t deltaRow = 0;
-    
-    // Determine input source
-    if (settingIMUEnabled && imuHardwareAvailable) {
-      sensors_event_t a, g, temp;
-      mpu.getEvent(&a, &g, &temp);
-      float ax = a.acceleration.x;
-      float ay = a.acceleration.y;
-      
-      if (abs(ax) > abs(ay) && abs(ax) > imuTiltThreshold) {
-         if (ax < 0) deltaCol = 1; else deltaCol = -1;
-      } else if (abs(ay) > abs(ax) && abs(ay) > imuTiltThreshold) {
-         if (ay > 0) deltaRow = 1; else deltaRow = -1;
-      }
-    } else {
-      // Joystick
-      if (joyYVal < joyCenterMin) deltaRow = -1;
-      else if (joyYVal > joyCenterMax) deltaRow = 1;
-      else if (joyXVal < joyCenterMin) deltaCol = -1;
-      else if (joyXVal > joyCenterMax) deltaCol = 1;
-    }
-    
-    if (deltaCol != 0 || deltaRow != 0) {
+// Points for clearing a level after levelMillis of game time: the base
+// points less a deduction per whole second, never below zero. The defaults
+// are the game's; host/tools/sim_farm passes its own to tune them.
+uint16_t levelClearBonus(uint32_t levelMillis, uint16_t clearPoints = baseLevelClearPoints,
+                         uint16_t secondPenalty = timeBonusDeduction) {
+  uint32_t deduction = levelMillis / 1000 * secondPenalty;
+  return deduction < clearPoints ? clearPoints - deduction : 0;
+}
+
+// Grade for the game's clear time against par: S within 10%, A within
+// 25%, B within 50%, C within double, D beyond
+char parGrade(uint32_t clearMillis, uint32_t parMillis) {
+  if (clearMillis * 10 <= parMillis * 11) return 'S';
+  if (clearMillis * 4 <= parMillis * 5) return 'A';
+  if (clearMillis * 2 <= parMillis * 3) return 'B';
+  if (clearMillis <= parMillis * 2) return 'C';
+  return 'D';
+}
+
+// What a game tick did, for handleGame() to play and draw
+enum GameEvent {
+  EVENT_STAR = 0x01,
+  EVENT_LEVEL_CLEAR = 0x02,
+  EVENT_VICTORY = 0x04,
+  EVENT_PAUSE = 0x08,
+  EVENT_PAUSE_MOVE = 0x10, // Pause menu selection changed
+  EVENT_RESUME = 0x20,
+  EVENT_EXIT = 0x40
+};
+
+// This tick's input as the rules see it
+TickInput currentTickInput() {
+  TickInput in;
+  in.joyX = joyXDir;
+  in.joyY = joyYDir;
+  in.tiltCol = imuTiltCol;
+  in.tiltRow = imuTiltRow;
+  in.button = btnJustPressed ? BUTTON_PRESS : (btnLongPressed ? BUTTON_LONG_PRESS : BUTTON_NONE);
+  return in;
+}
+
+// One step at most, joystick Y before X
+void moveDelta(const TickInput& in, int8_t& deltaCol, int8_t& deltaRow) {
+  deltaCol = 0;
+  deltaRow = 0;
+  if (settingIMUEnabled && imuHardwareAvailable) {
+    deltaCol = in.tiltCol;
+    deltaRow = in.tiltRow;
+  } else if (in.joyY != 0) {
+    deltaRow = in.joyY < 0 ? -1 : 1;
+  } else if (in.joyX != 0) {
+    deltaCol = in.joyX < 0 ? -1 : 1;
+  }
+}
+
+// The game rules for one tick of PLAYING or PAUSED. No sound, LCD or
+// matrix output and no time source but gameClock: given the same seed and
+// inputs it always ends in the same state.
+uint8_t gameTick(const TickInput& in) {
+  uint8_t events = 0;
+  gameClock += gameTickPeriod;
+  levelParStep();
+  
+  if (currentState == STATE_GAME_PLAYING) {
+    int8_t deltaCol, deltaRow;
+    moveDelta(in, deltaCol, deltaRow);
+    if ((deltaCol != 0 || deltaRow != 0) && gameClock - lastGameMoveTime > moveCooldown) {
       int8_t newCol = (int8_t)playerCol + deltaCol;
       int8_t newRow = (int8_t)playerRow + deltaRow;
       
-      // Check Bounds
-      if (newCol >= 0 && newCol < currentLevelDim && newRow >= 0 && newRow < currentLevelDim) {
-        // Check Wall
-        if (!isWall(newCol, newRow)) {
-          playerCol = newCol;
-          playerRow = newRow;
-          lastGameMoveTime = millis();
-          
-          // Check Events
-          for(uint8_t i=0; i<currentEntityCount; i++) {
-            if (currentEntities[i].col == playerCol && currentEntities[i].row == playerRow && currentEntities[i].type == ENTITY_STAR) {
-               // Remove star
-               currentEntities[i] = currentEntities[currentEntityCount - 1]; // Swap with last
-               currentEntityCount--;
-               currentScore += pointsPerStar;
-               currentLevelStarsCollected++;
-               playSoundSequence(seqCollectStar, 2);
-            }
-          }
+      // Check Bounds and Wall (negative positions wrap past the level edge)
+      if (!isWall(newCol, newRow)) {
+        playerCol = newCol;
+        playerRow = newRow;
+        lastGameMoveTime = gameClock;
+        
+        // 1. Check Star (one bit test in the star index)
+        if (currentLevel.takeStar(playerCol, playerRow)) {
+          currentScore += pointsPerStar;
+          currentLevelStarsCollected++;
+          events |= EVENT_STAR;
+        }
+        
+        // 2. Check Exit
+        if (playerCol == currentLevel.exitCol && playerRow == currentLevel.exitRow &&
+            currentLevelStarsCollected >= currentLevelStarsTotal) {
+          events |= EVENT_LEVEL_CLEAR;
+          currentScore += levelClearBonus(gameClock - levelStartTime);
+          levelScores[currentLevelIndex] = currentScore - levelStartScore;
+          RouteResult par = levelParSearch.result();
+          if (par.length == routeUnreachable) gameParKnown = false;
+          else gameParMillis += (uint32_t)par.length * moveRepeatMillis;
+          if (!par.exact) gameParExact = false;
+          gameClearMillis += gameClock - levelStartTime;
           
-          // 2. Check Exit
-          if (playerCol == currentLevelExitCol && playerRow == currentLevelExitRow) {
-             if (currentLevelStarsCollected >= currentLevelStarsTotal) {
-                // Level Clear
-                playSoundSequence(seqLevelComplete, 4);
-                // Calc Bonus
-                uint32_t timeUsed = (millis() - levelStartTime) / 1000;
-                uint32_t bonus = baseLevelClearPoints - (timeUsed * timeBonusDeduction);
-                if (bonus > 0) currentScore += bonus;
-                
-                if (currentLevelIndex < totalLevels - 1) {
-                  // Next Level
-                  initLevels(currentLevelIndex + 1);
-                } else {
-                  // Victory
-                  currentState = STATE_GAME_VICTORY;
-                  lcd.clear();
-                }
-             }
+          if (currentLevelIndex < totalLevels - 1) {
+            initLevels(currentLevelIndex + 1);
+          } else {
+            currentState = STATE_GAME_VICTORY;
+            events |= EVENT_VICTORY;
           }
         }
       }
     }
-  }
-  
-  // 2. Update LCD (Score)
-  static uint32_t lastLCDUpdate = 0;
-  if (millis() - lastLCDUpdate > LCDupdateInteval) {
-    lcd.setCursor(0, 0);
-    lcd.print(F("Lv:")); lcd.print(currentLevelIndex+1);
-    lcd.print(F(" Stars:")); lcd.print(currentLevelStarsCollected);
-    lcd.print(F("/")); lcd.print(currentLevelStarsTotal);
     
-    lcd.setCursor(0, 1);
-    lcd.print(F("Score: ")); lcd.print(currentScore);
-    lastLCDUpdate = millis();
-  }
-  
-  // 3. Render Matrix
-  updateMatrixViewport();
-  
-  // 4. Pause Check
-  if (btnJustPressed) {
-    currentState = STATE_GAME_PAUSED;
-    playSoundSequence(seqMenuSelect, 2);
-    lcd.clear();
+    if (currentState == STATE_GAME_PLAYING && in.button == BUTTON_PRESS) {
+      currentState = STATE_GAME_PAUSED;
+      events |= EVENT_PAUSE;
+    }
+  } else if (currentState == STATE_GAME_PAUSED) {
+    if (in.joyX != 0 && gameClock - lastPauseMoveTime > menuMoveCooldown) {
+      pausedSelectedOption = !pausedSelectedOption;
+      lastPauseMoveTime = gameClock;
+      events |= EVENT_PAUSE_MOVE;
+    }
+    
+    if (in.button == BUTTON_PRESS && pausedSelectedOption == 0) {
+      currentState = STATE_GAME_PLAYING;
+      events |= EVENT_RESUME;
+    } else if (in.button == BUTTON_PRESS || in.button == BUTTON_LONG_PRESS) {
+      currentState = STATE_MENU_MAIN;
+      events |= EVENT_EXIT;
+    }
   }
+  return events;
 }
 
-void handleGamePaused() {
-  static bool drawn = false;
-  static int8_t lastOpt = -1;
+// Same as gameTick() `ticks` times with the same input, but skips the ticks
+// that cannot change anything: no direction, a move still cooling down, or
+// a wall in the way (which stays there for the rest of the run). This is
+// what makes replaying a recorded game cheap.
+uint8_t gameRun(const TickInput& in, uint16_t ticks) {
+  uint8_t events = 0;
+  int8_t deltaCol, deltaRow;
+  moveDelta(in, deltaCol, deltaRow);
   
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
-    if (joyXVal < joyCenterMin || joyXVal > joyCenterMax) {
-      pausedSelectedOption = !pausedSelectedOption;
-      playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
-      drawn = false;
+  while (ticks > 0) {
+    if (currentState != STATE_GAME_PLAYING || in.button != BUTTON_NONE) {
+      if (currentState != STATE_GAME_PLAYING && currentState != STATE_GAME_PAUSED) break;
+      events |= gameTick(in);
+      ticks--;
+      continue;
+    }
+    if (deltaCol == 0 && deltaRow == 0) {
+      gameClock += (uint32_t)ticks * gameTickPeriod;
+      break;
+    }
+    
+    // Ticks until the cooldown lets the next move through
+    uint32_t waited = gameClock - lastGameMoveTime;
+    uint16_t idle = waited >= moveCooldown ? 0 : (moveCooldown - waited) / gameTickPeriod;
+    if (idle >= ticks) {
+      gameClock += (uint32_t)ticks * gameTickPeriod;
+      break;
+    }
+    gameClock += (uint32_t)idle * gameTickPeriod;
+    ticks -= idle;
+    
+    events |= gameTick(in);
+    ticks--;
+    if (lastGameMoveTime != gameClock) {
+      // Blocked
+      gameClock += (uint32_t)ticks * gameTickPeriod;
+      break;
     }
   }
+  return events;
+}
+
+void drawPauseMenu() {
+  lcd.setCursor(0, 0); lcd.print(F("PAUSED"));
+  lcd.setCursor(0, 1);
+  lcd.print(pausedSelectedOption == 0 ? F(">Continue  Exit") : F(" Continue >Exit"));
+}
+
+// PLAYING and PAUSED: feeds this tick's input to the rules (and the
+// recorder), then plays and draws what happened
+void handleGame() {
+  GameState before = currentState;
+  uint16_t fromCol = playerCol;
+  uint16_t fromRow = playerRow;
+  TickInput in = currentTickInput();
+#if RECORD_INPUT
+  recorder.record(in);
+#endif
+  uint8_t events = gameTick(in);
   
-  if (!drawn) {
-    lcd.setCursor(0, 0); lcd.print(F("PAUSED"));
-    lcd.setCursor(0, 1);
-    lcd.print(pausedSelectedOption == 0 ? F(">Continue  Exit") : F(" Continue >Exit"));
-    drawn = true;
+  if (events & EVENT_STAR) playSoundSequence(seqCollectStar, 2);
+  if (events & EVENT_LEVEL_CLEAR) playSoundSequence(seqLevelComplete, 4);
+  if (events & EVENT_PAUSE_MOVE) playSoundSequence(seqMenuMove, 1);
+  if (events & (EVENT_PAUSE | EVENT_RESUME | EVENT_EXIT)) {
+    playSoundSequence(seqMenuSelect, sizeof(seqMenuSelect) / sizeof(ToneSequence));
   }
+  // Same hold-off as the global long press back to the menu
+  if ((events & EVENT_EXIT) && in.button == BUTTON_LONG_PRESS) backToMenuIssuedTime = tickNow;
+  if (currentState != before) lcd.clear();
+  updateMusic();
   
-  if (btnJustPressed) {
-    playSoundSequence(seqMenuSelect, sizeof(seqMenuSelect) / sizeof(ToneSequence));
-    if (pausedSelectedOption == 0) {
-      currentState = STATE_GAME_PLAYING;
-      lcd.clear();
-    } else {
-      currentState = STATE_MENU_MAIN;
-      lcd.clear();
+  if (currentState == STATE_GAME_PLAYING) {
+    // Update LCD (Score)
+    static uint32_t lastLCDUpdate = 0;
+    if (tickNow - lastLCDUpdate > LCDupdateInteval) {
+      lcd.setCursor(0, 0);
+      lcd.print(F("Lv:")); lcd.print(currentLevelIndex+1);
+      lcd.print(F(" Stars:")); lcd.print(currentLevelStarsCollected);
+      lcd.print(F("/")); lcd.print(currentLevelStarsTotal);
+      
+      lcd.setCursor(0, 1);
+      lcd.print(F("Score: ")); lcd.print(currentScore);
+      lastLCDUpdate = tickNow;
     }
-    drawn = false;
+    
+    if (events || currentState != before || playerCol != fromCol || playerRow != fromRow) viewportDirty = true;
+  } else if (currentState == STATE_GAME_PAUSED) {
+    if (events & (EVENT_PAUSE | EVENT_PAUSE_MOVE)) drawPauseMenu();
+  } else {
+#if RECORD_INPUT
+    recorder.end();
+#endif
   }
 }
 
+// The finished game's score for each leaderboard table
+uint16_t leaderboardScore(uint8_t table) {
+  return table == leaderboardOverall ? currentScore : levelScores[table - 1];
+}
+
 void handleVictory() {
   static bool drawn = false;
   if (!drawn) {
     lcd.clear();
+    // The grade against par, '?' after it when some par was only the best
+    // route found in time (which can make it too kind)
     lcd.print(F("VICTORY!"));
+    if (gameParKnown) {
+      lcd.print(F(" Par "));
+      lcd.print(parGrade(gameClearMillis, gameParMillis));
+      if (!gameParExact) lcd.print('?');
+    }
     lcd.setCursor(0, 1);
     lcd.print(F("Score: ")); lcd.print(currentScore);
     playSoundSequence(seqVictory, 4);
     
-    lc.clearDisplay(0);
     // Happy face or Trophy
-    for(uint8_t i = 0; i < matrixSize; i ++) {
-      lc.setColumn(0, i, iconTrophy[i]);
-    }
+    matrix.drawIcon(iconTrophy);
     drawn = true;
   }
   
   if (btnJustPressed) {
-    // Check if high score
+    // Check if high score: a binary search per table
     bool isHighScore = false;
-    for(uint8_t i=0; i<highScoreCount; i++) {
-      if (currentScore > highScores[i].score) {
+    for (uint8_t t = 0; t < leaderboardTables; t++) {
+      uint16_t score = leaderboardScore(t);
+      if (score > 0 && leaderboards.rankFor(t, score) < leaderboardCapacity) {
         isHighScore = true;
         break;
       }
@@ -1135,6 +1565,23 @@ void handleVictory() {
   }
 }
 
+// Inserts the pending leaderboard entries one table at a time, each only
+// once the EEPROM queue has room for all of it, so name entry never waits
+// on the EEPROM; the rest go in from later runs
+void saveScores() {
+  static_assert(Leaderboards::recordSize + Leaderboards::intentSize + leaderboardCapacity + Leaderboards::headerSize <=
+                EepromQueue::capacity, "a leaderboard insert does not fit the EEPROM queue");
+  for (uint8_t t = 0; t < leaderboardTables; t++) {
+    if (!(pendingScoreTables & (1 << t))) continue;
+    if (eeprom.pending() + leaderboards.maxInsertBytes() > EepromQueue::capacity) {
+      scheduler.wake(TASK_SAVE_SCORES, tickNow + scoresRetryDelay);
+      return;
+    }
+    leaderboards.insert(t, pendingScores[t], pendingScoreName);
+    pendingScoreTables &= ~(1 << t);
+  }
+}
+
 void handleNameEntry() {
   static bool drawn = false;
   static uint8_t charIdx = 0;
@@ -1149,24 +1596,24 @@ void handleNameEntry() {
   }
   
   // Edit logic
-  if (millis() - lastInputMoveTime > menuMoveCooldown) {
+  if (tickNow - lastInputMoveTime > menuMoveCooldown) {
     bool changed = false;
     // Y axis changes letter
-    if (joyYVal < joyCenterMin) {
+    if (joyYDir < 0) {
       currentName[charIdx]++;
       if (currentName[charIdx] > 'Z') currentName[charIdx] = 'A';
       changed = true;
-    } else if (joyYVal > joyCenterMax) {
+    } else if (joyYDir > 0) {
       currentName[charIdx]--;
       if (currentName[charIdx] < 'A') currentName[charIdx] = 'Z';
       changed = true;
     }
     
     // X axis changes position
-    if (joyXVal > joyCenterMax) {
+    if (joyXDir > 0) {
       charIdx = (charIdx + 1) % 3;
       changed = true;
-    } else if (joyXVal < joyCenterMin) {
+    } else if (joyXDir < 0) {
       charIdx = (charIdx - 1 + 3) % 3;
       changed = true;
     }
@@ -1178,27 +1625,24 @@ void handleNameEntry() {
       lcd.setCursor(6+charIdx, 1);
       lcd.cursor();
       playSoundSequence(seqMenuMove, 1);
-      lastInputMoveTime = millis();
+      lastInputMoveTime = tickNow;
     }
   }
   
   if (btnJustPressed) {
     lcd.noCursor();
-    // Save Score
-    // Shift scores down
-    for(uint8_t i=0; i<highScoreCount; i++) {
-      if (currentScore > highScores[i].score) {
-        // Shift lower scores
-        for(uint8_t j=highScoreCount-1; j>i; j--) {
-          highScores[j] = highScores[j-1];
-        }
-        // Insert new
-        highScores[i].score = currentScore;
-        strcpy(highScores[i].name, currentName);
-        break;
-      }
+    // Save the game's total and each level's points under the same name,
+    // then show the overall table where the new entry lands (it goes in
+    // first)
+    uint8_t overallRank = leaderboards.rankFor(leaderboardOverall, leaderboardScore(leaderboardOverall));
+    memcpy(pendingScoreName, currentName, sizeof(pendingScoreName));
+    for (uint8_t t = 0; t < leaderboardTables; t++) {
+      pendingScores[t] = leaderboardScore(t);
+      if (pendingScores[t] > 0) pendingScoreTables |= 1 << t;
     }
-    saveHighScores();
+    saveScores();
+    leaderboardTable = leaderboardOverall;
+    leaderboardPage = overallRank < leaderboardCapacity ? overallRank / leaderboardPageLines : 0;
     playSoundSequence(seqMenuSelect, 2);
     currentState = STATE_MENU_HIGHSCORES;
     drawn = false;
@@ -1206,76 +1650,171 @@ void handleNameEntry() {
 }
 
 
+#if MATRIX_BENCH && defined(__AVR__)
+// Timer1 counts CPU cycles with interrupts off; the cost of reading it back
+// is measured the same way and taken off
+uint16_t matrixRowWriteCycles(Max7219& device) {
+  uint8_t sreg = SREG;
+  uint8_t timerA = TCCR1A;
+  uint8_t timerB = TCCR1B;
+  cli();
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TCNT1 = 0;
+  uint16_t overhead = TCNT1;
+  TCNT1 = 0;
+  device.write(MAX7219_DIGIT0, 0xA5);
+  uint16_t cycles = TCNT1;
+  TCCR1A = timerA;
+  TCCR1B = timerB;
+  SREG = sreg;
+  return cycles - overhead;
+}
+
+// Each bus runs on the pins it needs (the SPI wiring, then the default
+// one), so on a default-wired board the SPI pass scribbles on the matrix
+// until begin() resets it
+void benchMatrixBuses() {
+  static const char* const busNames[] = { "SPI", "PORTB", "shiftOut" };
+  static const uint8_t busPins[][3] = { { MOSI, SCK, A3 }, { 13, 12, 11 }, { 13, 12, 11 } };
+  Serial.begin(115200);
+  for (uint8_t bus = MAX7219_BUS_SPI; bus <= MAX7219_BUS_SHIFT_OUT; bus++) {
+    Max7219 device((Max7219Bus)bus, busPins[bus][0], busPins[bus][1], busPins[bus][2]);
+    device.begin();
+    Serial.print(F("MAX7219 row write, "));
+    Serial.print(busNames[device.activeBus()]);
+    Serial.print(F(": "));
+    Serial.print(matrixRowWriteCycles(device));
+    Serial.print(F(" cycles\n"));
+  }
+  SPCR = 0;
+}
+#endif
+
 void setup() {
   // 1. Hardware Init
-  pinMode(PIN_JOY_BTN, INPUT_PULLUP);
-  pinMode(PIN_BUZZER, OUTPUT);
+  button.begin(); // Pull-up + edge interrupt on pin 2
+  audio.begin();
   pinMode(PIN_LCD_BACKLIGHT, OUTPUT);
   
   // Seed random
   randomSeed(analogRead(PIN_RANDOM_SEED));
+  // From here on the ADC samples the joystick in the background
+  joystick.begin();
   
   // LCD
-  lcd.begin(16, 2);
-  lcd.clear();
+  lcdDevice.begin(16, 2);
   lcd.print(F("Initializing..."));
+  while (!lcd.flush(lcdFlushBudgetMicros));
   
   // Matrix
-  lc.shutdown(0, false);
-  lc.clearDisplay(0);
+#if MATRIX_BENCH && defined(__AVR__)
+  benchMatrixBuses();
+#endif
+  matrixDevice.begin();
+  matrixDevice.shutdown(false);
+  matrix.clear();
+  matrix.beginRefresh(MATRIX_SCAN_HZ);
   
-  // EEPROM
+  // EEPROM: the leaderboards first, so taking over an old board's scores
+  // inserts into checked tables
+  loadHighScores();
   loadSettings();
   applyLCDBrightness();
   applyMatrixBrightness();
-  loadHighScores();
+  
+#if RECORD_INPUT
+  Serial.begin(115200);
+#endif
   
   // IMU
   Wire.begin();
-  if (!mpu.begin()) {
-    imuHardwareAvailable = false;
-  } else {
-    imuHardwareAvailable = true;
-    mpu.setAccelerometerRange(MPU6050_RANGE_8_G);
-    mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
-  }
+  Wire.setClock(400000);
+  imuHardwareAvailable = imu.begin(imuSampleRateHz);
   
   // Init Inputs
+  tickNow = millis();
   readInputs();
   
   // Start
   currentState = STATE_INTRO;
 }
 
-void loop() {
-  uint32_t currentTime = millis();
+void toggleStarBlink() {
+  blinkStateStar = !blinkStateStar;
+  // In grayscale only an open exit blinks
+  if (!matrix.grayscale() || currentLevelStarsCollected >= currentLevelStarsTotal) viewportDirty = true;
+}
+
+void togglePlayerBlink() {
+  blinkStatePlayer = !blinkStatePlayer;
+  if (!matrix.grayscale()) viewportDirty = true;
+}
+
+// Other screens draw their own matrix icons once, so only the game viewport
+// is redrawn here
+void renderFrame() {
+  if (currentState != STATE_GAME_PLAYING || !viewportDirty) return;
+  viewportDirty = false;
+  updateMatrixViewport();
+  renderFrameRate.mark(tickNow);
+}
+
+void pollEeprom() {
+  eeprom.poll();
+}
+
+void drainRecording() {
+#if RECORD_INPUT
+  recorder.drain(Serial);
+#endif
+}
+
+void flushLcd() {
+  lcd.flush(lcdFlushBudgetMicros);
+}
+
+// |v| without the int16_t overflow at -32768
+uint16_t tiltMagnitude(int16_t v) {
+  return v < 0 ? (uint16_t)(0u - (uint16_t)v) : (uint16_t)v;
+}
+
+void updateImu() {
+  if (!settingIMUEnabled || !imuHardwareAvailable || currentState != STATE_GAME_PLAYING) {
+    imuTiltCol = 0;
+    imuTiltRow = 0;
+    return;
+  }
   
-  // Global Hardware Updates
-  readInputs();
-  updateAudio();
+  int16_t ax, ay;
+  if (!imu.readAverageXY(ax, ay)) return;
+  uint16_t magX = tiltMagnitude(ax);
+  uint16_t magY = tiltMagnitude(ay);
   
-  // Global Blink Timer (for Stars/Cursor)
-  if (currentTime - lastStarDisplayBlinkTime > starBlinkPeriod) {
-    blinkStateStar = !blinkStateStar;
-    lastStarDisplayBlinkTime = currentTime;
+  imuTiltCol = 0;
+  imuTiltRow = 0;
+  if (magX > magY && magX > imuTiltThreshold) {
+    imuTiltCol = (ax < 0) ? 1 : -1;
+  } else if (magY > magX && magY > imuTiltThreshold) {
+    imuTiltRow = (ay > 0) ? 1 : -1;
   }
+}
 
-  if(currentTime - lastPlayerDisplayBlinkTime > playerBlinkPeriod) {
-    blinkStatePlayer = !blinkStatePlayer;
-    lastPlayerDisplayBlinkTime = currentTime;
-  }
+void updateGame() {
+  gameTickRate.mark(tickNow);
+  readInputs();
   
   // Long press back to menu (Global safeguard, except during game)
-  if (btnPressed && (currentTime - lastDebounceTime > backToMenuDelay)) {
-     if (currentState != STATE_GAME_PLAYING && currentState != STATE_INTRO && currentState != STATE_NAME_ENTRY) {
+  if (btnLongPressed) {
+     if (currentState != STATE_GAME_PLAYING && currentState != STATE_GAME_PAUSED &&
+         currentState != STATE_INTRO && currentState != STATE_NAME_ENTRY) {
         currentState = STATE_MENU_MAIN;
-        backToMenuIssuedTime = currentTime;      
-        btnPressed = false; // consume press
+        backToMenuIssuedTime = tickNow;      
      }
   }
 
 
-  if(backToMenuIssuedTime - currentTime > backToMenuDelay) {
+  if(backToMenuIssuedTime - tickNow > backToMenuDelay) {
     // State Machine
     switch(currentState) {
       case STATE_INTRO:
@@ -1302,6 +1841,9 @@ void loop() {
       case STATE_MENU_SETTINGS_IMU:
         handleSettingsToggle(SET_IMU);
         break;
+      case STATE_MENU_SETTINGS_MAZE:
+        handleSettingsToggle(SET_MAZE);
+        break;
       case STATE_MENU_SETTINGS_RESET_SCORES:
         handleSettingsReset();
         break;
@@ -1312,10 +1854,8 @@ void loop() {
         handleHowTo();
         break;
       case STATE_GAME_PLAYING:
-        handleGamePlay();
-        break;
       case STATE_GAME_PAUSED:
-        handleGamePaused();
+        handleGame();
         break;
       case STATE_GAME_VICTORY:
         handleVictory();
@@ -1328,5 +1868,20 @@ void loop() {
         break;
     }
   }
+}
 
+void loop() {
+  tickNow = millis();
+  uint32_t nextWake = scheduler.runDue(tickNow);
+  
+#if defined(__AVR__)
+  // Nothing is due yet: idle until the next interrupt (Timer0 ticks every
+  // ~1 ms, so this never oversleeps a deadline by more than that)
+  if ((int32_t)(nextWake - millis()) > 0) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+  }
+#else
+  (void)nextWake;
+#endif
 }
@@ -0,0 +1,178 @@
+#include "matrix_display.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+static MatrixDisplay *refreshOwner = nullptr;
+
+ISR(TIMER1_OVF_vect) {
+  refreshOwner->refresh();
+}
+#endif
+
+// One register write is a 16-bit shift (opcode + data) per device
+static const uint8_t bytesPerDeviceWrite = 2;
+
+MatrixDisplay::MatrixDisplay(Max7219 &matrixDevice, uint8_t wide, uint8_t high)
+  : device(matrixDevice), modulesWide(wide), modulesHigh(high), shownValid(false), refreshing(false), phase(0) {
+  memset(planes, 0, sizeof(planes));
+  memset(shown, 0, sizeof(shown));
+  resetStats();
+}
+
+void MatrixDisplay::beginRefresh(uint16_t scanHz) {
+#if defined(__AVR__)
+  if (device.activeBus() == MAX7219_BUS_SHIFT_OUT || scanHz == 0) return;
+  refreshOwner = this;
+  phase = 0;
+  refreshing = true;
+  // Phase correct PWM with ICR1 as TOP at clk/8: up and down again takes
+  // 2 * ICR1 half-microseconds, so ICR1 is the tick in microseconds. The
+  // core's analogWrite() setup of the COM1x bits is left alone.
+  uint8_t sreg = SREG;
+  cli();
+  TCCR1B = 0;
+  ICR1 = 1000000UL / scanHz;
+  TCNT1 = 0;
+  TCCR1A = (TCCR1A & (_BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0))) | _BV(WGM11);
+  TCCR1B = _BV(WGM13) | _BV(CS11);
+  TIFR1 = _BV(TOV1);
+  TIMSK1 |= _BV(TOIE1);
+  SREG = sreg;
+#else
+  (void)scanHz;
+#endif
+}
+
+// The barriers keep the plane and shadow updates between the two
+void MatrixDisplay::pauseRefresh() {
+#if defined(__AVR__)
+  if (refreshing) TIMSK1 &= ~_BV(TOIE1);
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+void MatrixDisplay::resumeRefresh() {
+#if defined(__AVR__)
+  __asm__ __volatile__("" ::: "memory");
+  if (refreshing) TIMSK1 |= _BV(TOIE1);
+#endif
+}
+
+// The modules are mounted rotated: row i of a module's block ends up as its
+// digit column i. Transposing here lets every digit register go out as a
+// single write instead of the eight a column costs.
+static void transposeModule(const uint8_t *rows, uint8_t stride, uint8_t *regs) {
+  memset(regs, 0, 8);
+  for (uint8_t i = 0; i < 8; i++) {
+    uint8_t v = rows[i * stride];
+    uint8_t colBit = 0x80 >> i;
+    for (uint8_t k = 0; k < 8; k++) {
+      if (v & (0x80 >> k)) regs[k] |= colBit;
+    }
+  }
+}
+
+void MatrixDisplay::transpose(const uint8_t *rows, uint8_t (*regs)[8]) {
+  for (uint8_t m = 0; m < modulesWide * modulesHigh; m++) {
+    uint8_t mx = m % modulesWide, my = m / modulesWide;
+    transposeModule(rows + my * 8 * modulesWide + mx, modulesWide, regs[m]);
+  }
+}
+
+bool MatrixDisplay::send(const uint8_t (*regs)[8]) {
+  const uint8_t modules = modulesWide * modulesHigh;
+  bool sent = false;
+  for (uint8_t k = 0; k < 8; k++) {
+    bool changed = !shownValid;
+    for (uint8_t m = 0; m < modules && !changed; m++) changed = regs[m][k] != shown[m][k];
+    if (!changed) continue;
+
+    device.beginTransfer();
+    for (uint8_t m = modules; m-- > 0;) {
+      if (shownValid && regs[m][k] == shown[m][k]) {
+        device.shift(MAX7219_NOOP, 0);
+      } else {
+        device.shift(MAX7219_DIGIT0 + k, regs[m][k]);
+        shown[m][k] = regs[m][k];
+      }
+    }
+    device.endTransfer();
+    counters.rowsSent++;
+    counters.bytesShifted += modules * bytesPerDeviceWrite;
+    sent = true;
+  }
+  shownValid = true;
+  return sent;
+}
+
+void MatrixDisplay::drawPlanes(const uint8_t *dim, const uint8_t *bright) {
+  counters.framesPushed++;
+  if (refreshing) {
+    // Transposed first, so the interrupt is only held off for the copy
+    uint8_t next[2][maxModules][8];
+    memset(next, 0, sizeof(next));
+    transpose(dim, next[0]);
+    transpose(bright, next[1]);
+    pauseRefresh();
+    bool same = memcmp(planes, next, sizeof(planes)) == 0;
+    if (!same) memcpy(planes, next, sizeof(planes));
+    resumeRefresh();
+    if (same) counters.framesSkipped++;
+    return;
+  }
+
+  transpose(dim, planes[0]);
+  if (bright != dim) {
+    transpose(bright, planes[1]);
+    for (uint8_t m = 0; m < modulesWide * modulesHigh; m++)
+      for (uint8_t k = 0; k < 8; k++) planes[0][m][k] |= planes[1][m][k];
+  }
+  if (!send(planes[0])) counters.framesSkipped++;
+}
+
+void MatrixDisplay::refresh() {
+  phase = phase == 2 ? 0 : phase + 1;
+  if (phase == 2) return; // Second tick of the bright plane
+  if (send(planes[phase])) counters.refreshes++;
+}
+
+void MatrixDisplay::drawIcon(const uint8_t *icon) {
+  uint8_t frame[maxModules * 8];
+  memset(frame, 0, sizeof(frame));
+  uint8_t top = (height() - 8) / 2;
+  uint8_t left = (width() - 8) / 2;
+  for (uint8_t i = 0; i < 8; i++) {
+    uint8_t *row = frame + (top + i) * modulesWide + left / 8;
+    row[0] |= icon[i] >> (left % 8);
+    if (left % 8) row[1] |= icon[i] << (8 - left % 8);
+  }
+  drawFrame(frame);
+}
+
+void MatrixDisplay::clear() {
+  pauseRefresh();
+  device.clearDisplay();
+  memset(planes, 0, sizeof(planes));
+  memset(shown, 0, sizeof(shown));
+  shownValid = true;
+  counters.rowsSent += 8;
+  counters.bytesShifted += 8 * device.devices() * bytesPerDeviceWrite;
+  resumeRefresh();
+}
+
+void MatrixDisplay::setIntensity(uint8_t level) {
+  pauseRefresh();
+  device.setIntensity(level);
+  resumeRefresh();
+}
+
+void MatrixDisplay::invalidate() {
+  pauseRefresh();
+  shownValid = false;
+  resumeRefresh();
+}
+
+void MatrixDisplay::resetStats() {
+  memset(&counters, 0, sizeof(counters));
+}
@@ -0,0 +1,91 @@
+#ifndef MATRIX_DISPLAY_H
+#define MATRIX_DISPLAY_H
+
+#include <Arduino.h>
+#include "max7219.h"
+
+struct MatrixDisplayStats {
+  uint32_t framesPushed;
+  uint32_t framesSkipped; // frames identical to what the device already shows
+  uint32_t rowsSent;      // latched transactions, one digit row across the chain
+  uint32_t bytesShifted;
+  uint32_t refreshes;     // bit-plane switches sent by the refresh interrupt
+};
+
+// A panel of 8x8 modules on one MAX7219 chain, modulesWide by modulesHigh,
+// chained row by row from the top left (device 0). Keeps a copy of the
+// digit registers last written to every device and only sends the digit
+// rows a new frame changes: each one goes to the whole chain in a single
+// transaction, with no-ops for the devices whose digit is unchanged.
+//
+// With beginRefresh(), frames have four brightness levels. A frame is then
+// two bit-planes, dim (weight 1) and bright (weight 2), which the Timer1
+// overflow interrupt shows in turn: the dim plane for one tick, the bright
+// one for the next two. Only the digits that differ between the planes go
+// out at each switch, so a frame with no greys costs nothing to refresh.
+// Drawing then just updates the planes; everything else that touches the
+// chain keeps the interrupt off while it does.
+//
+// The MAX7219 lights its digits one at a time from its own oscillator, so
+// a tick is made exactly one of its scans long: any whole number of scans
+// lights every digit for the same time whatever the phase, where a tick
+// unrelated to the scan lights some digits for one slot more than others,
+// and which ones drifts (rows shimmer). The oscillator is only specified as
+// 500-1300 Hz (800 typical) and cannot be read back, so the rate is set
+// per panel, and a chip off from it by e gives a digit up to 8e too much
+// or too little of a plane, beating at e times the scan rate. Each chip of
+// a chain runs its own oscillator.
+class MatrixDisplay {
+public:
+  static const uint8_t maxModules = 4;
+
+  MatrixDisplay(Max7219 &device, uint8_t modulesWide = 1, uint8_t modulesHigh = 1);
+
+  // Starts the bit-plane refresh with ticks of one scan at scanHz, unless
+  // the chain is on the shiftOut bus, which is far too slow for it (and all
+  // the host has). Timer1 then counts to ICR1: PWM on pins 9 and 10 keeps
+  // working but its duty is OCR1x / ICR1 instead of / 255.
+  void beginRefresh(uint16_t scanHz);
+  bool grayscale() const { return refreshing; }
+
+  // A frame is 8 * modulesHigh rows of modulesWide bytes. Bit 7 of a row's
+  // first byte is its leftmost LED as the player sees it, so a one-module
+  // frame has the same layout as the icons.
+  void drawFrame(const uint8_t *rows) { drawPlanes(rows, rows); }
+  // An LED is lit at the sum of the weights of the planes it is on:
+  // dim 1, bright 2, both 3. Without grayscale it is just on.
+  void drawPlanes(const uint8_t *dim, const uint8_t *bright);
+  // An 8x8 icon in the middle of the panel
+  void drawIcon(const uint8_t *icon);
+  void clear();
+  void setIntensity(uint8_t level);
+  // Force a full resend, e.g. after the device was reset behind our back
+  void invalidate();
+
+  // One refresh tick; the Timer1 overflow interrupt calls this
+  void refresh();
+
+  uint8_t width() const { return modulesWide * 8; }
+  uint8_t height() const { return modulesHigh * 8; }
+
+  const MatrixDisplayStats &stats() const { return counters; }
+  void resetStats();
+
+private:
+  void pauseRefresh();
+  void resumeRefresh();
+  void transpose(const uint8_t *rows, uint8_t (*regs)[8]);
+  bool send(const uint8_t (*regs)[8]);
+
+  Max7219 &device;
+  uint8_t modulesWide;
+  uint8_t modulesHigh;
+  uint8_t planes[2][maxModules][8]; // Digit registers of each plane
+  uint8_t shown[maxModules][8];
+  bool shownValid;
+  bool refreshing;
+  uint8_t phase; // Refresh tick: 0 dim plane, 1-2 bright plane
+  MatrixDisplayStats counters;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "max7219.h"
+
+Max7219::Max7219(Max7219Bus busType, uint8_t din, uint8_t clk, uint8_t load, uint8_t devices)
+  : bus(busType), dinPin(din), clkPin(clk), loadPin(load), deviceCount(devices ? devices : 1) {
+}
+
+void Max7219::begin() {
+  pinMode(dinPin, OUTPUT);
+  pinMode(clkPin, OUTPUT);
+  pinMode(loadPin, OUTPUT);
+  digitalWrite(dinPin, LOW);
+  digitalWrite(clkPin, LOW);
+  // LOAD idles high; every write pulls it low and lets it back up
+  digitalWrite(loadPin, HIGH);
+
+#if defined(__AVR__)
+  loadToggle = portInputRegister(digitalPinToPort(loadPin));
+  loadMask = digitalPinToBitMask(loadPin);
+  dinMask = digitalPinToBitMask(dinPin);
+  clkMask = digitalPinToBitMask(clkPin);
+  dinHigh = false;
+  if (bus == MAX7219_BUS_SPI && (dinPin != MOSI || clkPin != SCK)) bus = MAX7219_BUS_SHIFT_OUT;
+  if (bus == MAX7219_BUS_PORTB && (digitalPinToPort(dinPin) != PB || digitalPinToPort(clkPin) != PB)) {
+    bus = MAX7219_BUS_SHIFT_OUT;
+  }
+  if (bus == MAX7219_BUS_SPI) {
+    // A master whose SS pin is an input drops out of master mode when it
+    // is pulled low
+    pinMode(SS, OUTPUT);
+    // Mode 0, MSB first, f/2: the MAX7219 takes up to 10 MHz
+    SPCR = _BV(SPE) | _BV(MSTR);
+    SPSR = _BV(SPI2X);
+  }
+#else
+  // The host has no ports or SPI to drive, only pins
+  bus = MAX7219_BUS_SHIFT_OUT;
+#endif
+
+  write(MAX7219_DISPLAY_TEST, 0);
+  write(MAX7219_SCAN_LIMIT, 7);
+  write(MAX7219_DECODE_MODE, 0);
+  clearDisplay();
+  shutdown(true);
+}
+
+#if defined(__AVR__)
+// A PINB write toggles the PORTB bits set in it in one `out`, so there is
+// no read-modify-write for an interrupt to land in, and the LCD pins on
+// PORTB are never touched. CLK is high for one cycle (62.5 ns, the
+// MAX7219 needs 50).
+void Max7219::shiftPortB(uint8_t value) {
+  const uint8_t din = dinMask;
+  const uint8_t clk = clkMask;
+  bool high = dinHigh;
+  for (uint8_t bit = 0x80; bit; bit >>= 1) {
+    if (((value & bit) != 0) != high) {
+      PINB = din;
+      high = !high;
+    }
+    PINB = clk;
+    PINB = clk;
+  }
+  dinHigh = high;
+}
+#endif
+
+void Max7219::beginTransfer() {
+#if defined(__AVR__)
+  if (bus != MAX7219_BUS_SHIFT_OUT) {
+    *loadToggle = loadMask;
+    return;
+  }
+#endif
+  digitalWrite(loadPin, LOW);
+}
+
+void Max7219::shiftByte(uint8_t value) {
+#if defined(__AVR__)
+  if (bus == MAX7219_BUS_SPI) {
+    SPDR = value;
+    while (!(SPSR & _BV(SPIF)));
+    return;
+  }
+  if (bus == MAX7219_BUS_PORTB) {
+    shiftPortB(value);
+    return;
+  }
+#endif
+  shiftOut(dinPin, clkPin, MSBFIRST, value);
+}
+
+void Max7219::shift(uint8_t reg, uint8_t data) {
+  shiftByte(reg);
+  shiftByte(data);
+}
+
+void Max7219::endTransfer() {
+#if defined(__AVR__)
+  if (bus != MAX7219_BUS_SHIFT_OUT) {
+    *loadToggle = loadMask;
+    return;
+  }
+#endif
+  digitalWrite(loadPin, HIGH);
+}
+
+void Max7219::write(uint8_t reg, uint8_t data) {
+  beginTransfer();
+  for (uint8_t i = 0; i < deviceCount; i++) shift(reg, data);
+  endTransfer();
+}
+
+void Max7219::clearDisplay() {
+  for (uint8_t row = 0; row < 8; row++) write(MAX7219_DIGIT0 + row, 0);
+}
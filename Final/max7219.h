@@ -0,0 +1,77 @@
+#ifndef MAX7219_H
+#define MAX7219_H
+
+#include <Arduino.h>
+
+// MAX7219 register addresses
+enum Max7219Register {
+  MAX7219_NOOP = 0,
+  MAX7219_DIGIT0 = 1, // Digits 0..7 are 1..8
+  MAX7219_DECODE_MODE = 9,
+  MAX7219_INTENSITY = 10,
+  MAX7219_SCAN_LIMIT = 11,
+  MAX7219_SHUTDOWN = 12,
+  MAX7219_DISPLAY_TEST = 15
+};
+
+// How register writes get to the device. All three shift the same 16 bits
+// (register, then data, MSB first) and latch them with LOAD's rising edge.
+enum Max7219Bus {
+  // The ATmega's SPI peripheral at 8 MHz: DIN on MOSI (11), CLK on SCK (13)
+  MAX7219_BUS_SPI,
+  // DIN and CLK anywhere on PORTB (pins 8-13), bit-banged by toggling them
+  // through PINB, which leaves the other PORTB pins alone
+  MAX7219_BUS_PORTB,
+  // digitalWrite()/shiftOut() on any pins, as LedControl does; also what
+  // the other two fall back to when the pins do not allow them
+  MAX7219_BUS_SHIFT_OUT
+};
+
+// A chain of MAX7219s driving 8x8 matrices, with no decoding. Device 0 is
+// the one on DIN; each passes what it shifts out on to the next, and LOAD
+// latches all of them at once. LOAD can be on any pin whatever the bus.
+class Max7219 {
+public:
+  Max7219(Max7219Bus busType, uint8_t din, uint8_t clk, uint8_t load, uint8_t devices = 1);
+
+  // Sets up the pins (and the SPI peripheral) and puts every device in a
+  // known state: display test off, all digits scanned, no decoding,
+  // cleared and shut down
+  void begin();
+
+  // One latched transaction: shift() once per device, the last device in
+  // the chain first. MAX7219_NOOP leaves a device as it is.
+  void beginTransfer();
+  void shift(uint8_t reg, uint8_t data);
+  void endTransfer();
+
+  // The same register write to every device, in one transaction
+  void write(uint8_t reg, uint8_t data);
+  void setIntensity(uint8_t level) { write(MAX7219_INTENSITY, level & 0x0F); }
+  void shutdown(bool off) { write(MAX7219_SHUTDOWN, off ? 0 : 1); }
+  void clearDisplay();
+
+  uint8_t devices() const { return deviceCount; }
+
+  // The bus actually in use after begin()
+  Max7219Bus activeBus() const { return bus; }
+
+private:
+  void shiftByte(uint8_t value);
+  void shiftPortB(uint8_t value);
+
+  Max7219Bus bus;
+  uint8_t dinPin;
+  uint8_t clkPin;
+  uint8_t loadPin;
+  uint8_t deviceCount;
+#if defined(__AVR__)
+  volatile uint8_t *loadToggle; // LOAD's PINx register
+  uint8_t loadMask;
+  uint8_t dinMask;
+  uint8_t clkMask;
+  bool dinHigh; // DIN's level after the last bit shifted through PINB
+#endif
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef MAZE_GEN_H
+#define MAZE_GEN_H
+
+#include <Arduino.h>
+
+// Procedural perfect mazes (exactly one path between any two rooms) carved
+// straight into bit-packed rows with the same layout as the level data:
+// column 0 is the MSB of the first word of a row, and a row spans `stride`
+// words. Rooms sit on odd coordinates; everything else starts as wall.
+//
+// The recursive backtracker keeps its path as 2-bit directions in a caller
+// supplied buffer, so memory use is fixed up front: mazeStackBytes() bytes
+// for the stack plus the row buffer itself.
+
+constexpr uint16_t mazeRoomCols(uint16_t width) { return (width - 1) / 2; }
+constexpr uint16_t mazeRoomRows(uint16_t height) { return (height - 1) / 2; }
+constexpr uint16_t mazeRoomCount(uint16_t width, uint16_t height) {
+  return mazeRoomCols(width) * mazeRoomRows(height);
+}
+// The path never holds more steps than there are rooms
+constexpr uint16_t mazeStackBytes(uint16_t width, uint16_t height) {
+  return (mazeRoomCount(width, height) * 2 + 7) / 8;
+}
+
+template <typename Word>
+inline Word mazeBitMask(uint16_t c) {
+  return (Word)((Word)1 << (sizeof(Word) * 8 - 1 - (c % (sizeof(Word) * 8))));
+}
+
+template <typename Word>
+inline bool mazeIsWall(const Word *rows, uint16_t stride, uint16_t c, uint16_t r) {
+  return rows[r * stride + c / (sizeof(Word) * 8)] & mazeBitMask<Word>(c);
+}
+
+template <typename Word>
+inline void mazeOpen(Word *rows, uint16_t stride, uint16_t c, uint16_t r) {
+  rows[r * stride + c / (sizeof(Word) * 8)] &= (Word)~mazeBitMask<Word>(c);
+}
+
+// Carves a maze into rows[height][stride]. `rng(n)` must return a value in
+// [0, n). Returns the deepest the path stack got. If stackBytes is smaller
+// than mazeStackBytes(width, height), rooms past that depth stay walled.
+template <typename Word, typename Rng>
+uint16_t generateMaze(Word *rows, uint16_t stride, uint16_t width, uint16_t height,
+                      uint8_t *stack, uint16_t stackBytes, Rng &rng) {
+  const uint8_t bits = sizeof(Word) * 8;
+  static const int8_t stepCol[4] = { 0, 2, 0, -2 };
+  static const int8_t stepRow[4] = { -2, 0, 2, 0 };
+
+  // Solid walls across the level width, nothing past it
+  for (uint16_t r = 0; r < height; r++) {
+    for (uint16_t w = 0; w < stride; w++) {
+      uint16_t firstCol = w * bits;
+      Word fill = 0;
+      if (firstCol + bits <= width) fill = (Word)~(Word)0;
+      else if (firstCol < width) fill = (Word)~((Word)~(Word)0 >> (width - firstCol));
+      rows[r * stride + w] = fill;
+    }
+  }
+  if (mazeRoomCount(width, height) == 0) return 0;
+
+  const uint16_t lastRoomCol = mazeRoomCols(width) * 2 - 1;
+  const uint16_t lastRoomRow = mazeRoomRows(height) * 2 - 1;
+  const uint16_t capacity = stackBytes * 4;
+
+  uint16_t c = 1;
+  uint16_t r = 1;
+  uint16_t depth = 0;
+  uint16_t peak = 0;
+  mazeOpen(rows, stride, c, r);
+
+  for (;;) {
+    uint8_t options[4];
+    uint8_t count = 0;
+    for (uint8_t d = 0; d < 4; d++) {
+      int16_t nc = (int16_t)c + stepCol[d];
+      int16_t nr = (int16_t)r + stepRow[d];
+      if (nc < 1 || nr < 1 || nc > lastRoomCol || nr > lastRoomRow) continue;
+      if (mazeIsWall(rows, stride, nc, nr)) options[count++] = d;
+    }
+
+    if (count > 0 && depth < capacity) {
+      uint8_t d = options[count > 1 ? rng(count) : 0];
+      mazeOpen(rows, stride, c + stepCol[d] / 2, r + stepRow[d] / 2);
+      c += stepCol[d];
+      r += stepRow[d];
+      mazeOpen(rows, stride, c, r);
+
+      uint8_t shift = (depth & 3) * 2;
+      stack[depth >> 2] = (stack[depth >> 2] & ~(0x03 << shift)) | (d << shift);
+      depth++;
+      if (depth > peak) peak = depth;
+    } else {
+      if (depth == 0) break;
+      depth--;
+      uint8_t d = (stack[depth >> 2] >> ((depth & 3) * 2)) & 0x03;
+      c -= stepCol[d];
+      r -= stepRow[d];
+    }
+  }
+  return peak;
+}
+
+#endif
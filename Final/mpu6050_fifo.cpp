@@ -0,0 +1,98 @@
+#include "mpu6050_fifo.h"
+
+// Register map (MPU-6000/6050 register map rev 4.2)
+static const uint8_t REG_SMPLRT_DIV = 0x19;
+static const uint8_t REG_CONFIG = 0x1A;
+static const uint8_t REG_ACCEL_CONFIG = 0x1C;
+static const uint8_t REG_FIFO_EN = 0x23;
+static const uint8_t REG_USER_CTRL = 0x6A;
+static const uint8_t REG_PWR_MGMT_1 = 0x6B;
+static const uint8_t REG_PWR_MGMT_2 = 0x6C;
+static const uint8_t REG_FIFO_COUNT_H = 0x72;
+static const uint8_t REG_FIFO_R_W = 0x74;
+static const uint8_t REG_WHO_AM_I = 0x75;
+
+static const uint8_t whoAmIValue = 0x68;
+static const uint8_t configDlpf21Hz = 0x04;  // also makes the base sample rate 1 kHz
+static const uint8_t accelRange8g = 0x10;
+static const uint8_t fifoEnAccel = 0x08;     // X, Y and Z: the FIFO can't split them
+static const uint8_t userCtrlFifoEn = 0x40;
+static const uint8_t userCtrlFifoReset = 0x04;
+static const uint8_t pwrMgmt2GyroStandby = 0x07;
+
+static const uint8_t sampleBytes = 6;
+// The AVR Wire library buffers 32 bytes per transfer
+static const uint8_t samplesPerRead = 32 / sampleBytes;
+
+// Big-endian register pair; two statements so the reads happen in order
+static int16_t readWord(TwoWire &wire) {
+  uint8_t high = wire.read();
+  uint8_t low = wire.read();
+  return (int16_t)(((uint16_t)high << 8) | low);
+}
+
+Mpu6050Fifo::Mpu6050Fifo(TwoWire &bus, uint8_t address) : wire(bus), addr(address) {
+}
+
+bool Mpu6050Fifo::writeRegister(uint8_t reg, uint8_t value) {
+  wire.beginTransmission(addr);
+  wire.write(reg);
+  wire.write(value);
+  return wire.endTransmission() == 0;
+}
+
+// Leaves `count` bytes waiting in the Wire receive buffer
+bool Mpu6050Fifo::readRegisters(uint8_t reg, uint8_t count) {
+  wire.beginTransmission(addr);
+  wire.write(reg);
+  if (wire.endTransmission(false) != 0) return false;
+  return wire.requestFrom(addr, count) == count;
+}
+
+bool Mpu6050Fifo::begin(uint8_t sampleRateHz) {
+  if (!readRegisters(REG_WHO_AM_I, 1) || wire.read() != whoAmIValue) return false;
+
+  // Wake up on the internal oscillator with the gyros in standby
+  writeRegister(REG_PWR_MGMT_1, 0x00);
+  writeRegister(REG_PWR_MGMT_2, pwrMgmt2GyroStandby);
+  writeRegister(REG_CONFIG, configDlpf21Hz);
+  writeRegister(REG_SMPLRT_DIV, 1000 / sampleRateHz - 1);
+  writeRegister(REG_ACCEL_CONFIG, accelRange8g);
+  writeRegister(REG_FIFO_EN, fifoEnAccel);
+  resetFifo();
+  return true;
+}
+
+void Mpu6050Fifo::resetFifo() {
+  writeRegister(REG_USER_CTRL, userCtrlFifoEn | userCtrlFifoReset);
+}
+
+bool Mpu6050Fifo::readAverageXY(int16_t &x, int16_t &y) {
+  if (!readRegisters(REG_FIFO_COUNT_H, 2)) return false;
+  uint16_t count = (uint16_t)readWord(wire);
+
+  // A partial sample means the FIFO overflowed and lost alignment
+  if (count > maxBatchSamples * sampleBytes || count % sampleBytes != 0) {
+    resetFifo();
+    return false;
+  }
+  uint8_t samples = count / sampleBytes;
+  if (samples == 0) return false;
+
+  int32_t sumX = 0;
+  int32_t sumY = 0;
+  for (uint8_t left = samples; left > 0; ) {
+    uint8_t n = left < samplesPerRead ? left : samplesPerRead;
+    if (!readRegisters(REG_FIFO_R_W, n * sampleBytes)) return false;
+    for (uint8_t i = 0; i < n; i++) {
+      // Big-endian X, Y, Z; Z is clocked out but never decoded
+      sumX += readWord(wire);
+      sumY += readWord(wire);
+      readWord(wire);
+    }
+    left -= n;
+  }
+  x = sumX / samples;
+  y = sumY / samples;
+  return true;
+}
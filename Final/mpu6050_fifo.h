@@ -0,0 +1,41 @@
+#ifndef MPU6050_FIFO_H
+#define MPU6050_FIFO_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Minimal MPU6050 driver for tilt input. The accelerometer fills the chip's
+// FIFO at a fixed sample rate (gyro in standby, no temperature), and each
+// poll drains it in one burst and averages the raw X/Y counts. There is no
+// floating point anywhere: callers get raw int16_t counts at +-8 g, i.e.
+// mpu6050CountsPerG per g.
+class Mpu6050Fifo {
+public:
+  static const uint8_t defaultAddress = 0x68;
+
+  explicit Mpu6050Fifo(TwoWire &bus, uint8_t address = defaultAddress);
+
+  // Configures +-8 g, the 21 Hz low-pass filter and `sampleRateHz` samples
+  // per second into the FIFO. Returns false if no MPU6050 answers.
+  bool begin(uint8_t sampleRateHz);
+
+  // Averages every sample queued since the last call. Returns false when
+  // there was nothing new, or when the FIFO held more than maxBatchSamples
+  // (stale data after a pause); the FIFO is then restarted.
+  bool readAverageXY(int16_t &x, int16_t &y);
+
+  void resetFifo();
+
+  static const uint8_t maxBatchSamples = 10;
+
+private:
+  bool writeRegister(uint8_t reg, uint8_t value);
+  bool readRegisters(uint8_t reg, uint8_t count);
+
+  TwoWire &wire;
+  uint8_t addr;
+};
+
+const int16_t mpu6050CountsPerG = 4096;
+
+#endif
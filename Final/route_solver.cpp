@@ -0,0 +1,176 @@
+#include "route_solver.h"
+
+// Every distance the search reads comes through here; host builds count
+// them for route_bench's estimate of the time on the board
+inline uint16_t RouteSearch::lookup(uint8_t i, uint8_t j) {
+#if !defined(__AVR__)
+  lookups++;
+#endif
+  return routeDistance(dist, i, j);
+}
+
+// A route from `at` through the stars left to the exit is a spanning tree
+// of those points, so it is no shorter than their minimum one (Prim's).
+// The star loops here and below shift the set one bit at a time: the AVR
+// has no barrel shifter, and `1 << star` is a loop of its own.
+uint16_t RouteSearch::treeBound(uint8_t at, uint16_t left) {
+  uint8_t points[routeMaxStars + 1];
+  uint16_t reach[routeMaxStars + 1];
+  uint8_t n = 0;
+  for (uint8_t p = 1; left; left >>= 1, p++)
+    if (left & 1) points[n++] = p;
+  points[n++] = exit;
+  for (uint8_t i = 0; i < n; i++) reach[i] = lookup(at, points[i]);
+
+  uint16_t total = 0;
+  while (n > 0) {
+    uint8_t nearest = 0;
+    for (uint8_t i = 1; i < n; i++)
+      if (reach[i] < reach[nearest]) nearest = i;
+    if (reach[nearest] == routeUnreachable) return routeUnreachable;
+    total += reach[nearest];
+    uint8_t joined = points[nearest];
+    n--;
+    points[nearest] = points[n];
+    reach[nearest] = reach[n];
+    for (uint8_t i = 0; i < n; i++) {
+      uint16_t d = lookup(joined, points[i]);
+      if (d < reach[i]) reach[i] = d;
+    }
+  }
+  return total;
+}
+
+// One node: a finished route is scored, a partial one that can still beat
+// the best goes on the stack to branch from
+void RouteSearch::visit(uint8_t at, uint16_t left, uint16_t length) {
+  nodes++;
+
+  if (!left) {
+    uint16_t home = lookup(at, exit);
+    if (home != routeUnreachable && length + home < best) best = length + home;
+    return;
+  }
+
+  // Every remaining star has to be reached and then left for the exit
+  uint16_t bound = 0;
+  uint16_t rest = left;
+  for (uint8_t p = 1; rest; rest >>= 1, p++) {
+    if (!(rest & 1)) continue;
+    uint16_t there = lookup(at, p);
+    uint16_t home = lookup(p, exit);
+    if (there == routeUnreachable || home == routeUnreachable) return;
+    if (there + home > bound) bound = there + home;
+  }
+  if (length + bound >= best) return;
+  bound = treeBound(at, left);
+  if (bound == routeUnreachable || length + bound >= best) return;
+
+  Frame &f = frames[depth++];
+  f.at = at;
+  f.left = left;
+  f.length = length;
+  f.tried = 0;
+}
+
+void RouteSearch::begin(const uint16_t *distances, uint8_t stars, uint32_t nodeBudget) {
+  dist = distances;
+  exit = stars + 1;
+  best = routeUnreachable;
+  nodes = 0;
+  budget = nodeBudget;
+  cut = false;
+  depth = 0;
+#if !defined(__AVR__)
+  lookups = 0;
+#endif
+  if (budget == 0) cut = true;
+  else visit(0, (uint16_t)((1ul << stars) - 1), 0);
+}
+
+bool RouteSearch::run(uint32_t slice) {
+  while (depth > 0 && slice > 0) {
+    Frame &f = frames[depth - 1];
+    uint16_t open = f.left & ~f.tried;
+    if (!open) {
+      depth--;
+      continue;
+    }
+
+    // Nearest untried star first
+    uint8_t next = 0;
+    uint16_t nextBit = 0;
+    uint16_t nearest = routeUnreachable;
+    uint16_t bit = 1;
+    for (uint8_t p = 1; open; open >>= 1, bit <<= 1, p++) {
+      if (!(open & 1)) continue;
+      uint16_t there = lookup(f.at, p);
+      if (there < nearest) {
+        nearest = there;
+        next = p;
+        nextBit = bit;
+      }
+    }
+    f.tried |= nextBit;
+    if (f.length + nearest + lookup(next, exit) >= best) continue;
+
+    if (nodes >= budget) {
+      cut = true;
+      depth = 0;
+      break;
+    }
+    slice--;
+    visit(next, f.left & ~nextBit, f.length + nearest);
+  }
+  return depth == 0;
+}
+
+RouteResult RouteSearch::result() const {
+  RouteResult r = { best, nodes, !cut && depth == 0, 0 };
+#if !defined(__AVR__)
+  r.lookups = lookups;
+#endif
+  return r;
+}
+
+RouteResult routeSearch(const uint16_t *dist, uint8_t stars, uint32_t budget) {
+  RouteSearch search;
+  search.begin(dist, stars, budget);
+  search.run(budget);
+  return search.result();
+}
+
+uint16_t routeHeldKarp(const uint16_t *dist, uint8_t stars, uint16_t *table) {
+  const uint8_t exit = stars + 1;
+  if (stars == 0) return routeDistance(dist, 0, exit);
+
+  // Unpacked, the inner loop is a plain row lookup
+  uint16_t between[routeMaxStars][routeMaxStars];
+  for (uint8_t i = 0; i < stars; i++)
+    for (uint8_t j = 0; j < stars; j++) between[j][i] = routeDistance(dist, i + 1, j + 1);
+
+  // table[mask * stars + j]: shortest walk from the start through the stars
+  // in mask, ending on star j, built from the walks through mask without j
+  const uint32_t full = (1ul << stars) - 1;
+  for (uint32_t mask = 1; mask <= full; mask++) {
+    for (uint8_t j = 0; j < stars; j++) {
+      if (!(mask & (1ul << j))) continue;
+      uint32_t rest = mask & ~(1ul << j);
+      uint32_t shortest = rest ? routeUnreachable : routeDistance(dist, 0, j + 1);
+      const uint16_t *walks = &table[rest * stars];
+      for (uint32_t bits = rest; bits; bits &= bits - 1) {
+        uint8_t i = __builtin_ctzl(bits);
+        uint32_t via = (uint32_t)walks[i] + between[j][i];
+        if (via < shortest) shortest = via;
+      }
+      table[mask * stars + j] = (uint16_t)shortest;
+    }
+  }
+
+  uint32_t shortest = routeUnreachable;
+  for (uint8_t j = 0; j < stars; j++) {
+    uint32_t via = (uint32_t)table[full * stars + j] + routeDistance(dist, j + 1, exit);
+    if (via < shortest) shortest = via;
+  }
+  return (uint16_t)shortest;
+}
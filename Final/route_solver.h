@@ -0,0 +1,110 @@
+#ifndef ROUTE_SOLVER_H
+#define ROUTE_SOLVER_H
+
+#include <Arduino.h>
+#include "level_analysis.h"
+
+// The par route of a level: the fewest steps that collect every star and
+// end on the exit. Its points are numbered 0 for the start, 1..k for the
+// stars and k + 1 for the exit; the steps between each pair are kept as
+// the lower triangle of the (symmetric) distance matrix.
+
+const uint8_t routeMaxStars = 16; // Star sets are uint16_t masks
+const uint16_t routeUnreachable = 0xFFFF;
+
+constexpr uint16_t routeDistanceCount(uint8_t points) {
+  return (uint16_t)points * (points - 1) / 2;
+}
+
+inline uint16_t routePairIndex(uint8_t i, uint8_t j) {
+  return i > j ? (uint16_t)i * (i - 1) / 2 + j : (uint16_t)j * (j - 1) / 2 + i;
+}
+
+inline uint16_t routeDistance(const uint16_t *dist, uint8_t i, uint8_t j) {
+  return i == j ? 0 : dist[routePairIndex(i, j)];
+}
+
+// Fills dist[routeDistanceCount(points)] by flooding the level bitboard
+// once from every point but the last, noting the layer each later point
+// turns up in. A flood stops as soon as it has found all of them.
+template <typename Geometry>
+void routeDistances(const void *level, const uint8_t *cols, const uint8_t *rows, uint8_t points,
+                    uint16_t *dist) {
+  typedef typename Geometry::Row Row;
+  Row visited[Geometry::height];
+  Row frontier[Geometry::height];
+  for (uint8_t i = 0; i + 1 < points; i++) {
+    for (uint8_t j = i + 1; j < points; j++) dist[routePairIndex(i, j)] = routeUnreachable;
+    uint8_t pending = points - 1 - i;
+    floodSeed<Geometry>(visited, frontier, cols[i], rows[i]);
+    for (uint16_t steps = 1; pending > 0 && floodStep<Geometry>(level, visited, frontier); steps++) {
+      for (uint8_t j = i + 1; j < points; j++) {
+        uint16_t &d = dist[routePairIndex(i, j)];
+        if (d == routeUnreachable && (frontier[rows[j]] & levelColumnMask<Row>(cols[j]))) {
+          d = steps;
+          pending--;
+        }
+      }
+    }
+  }
+}
+
+struct RouteResult {
+  uint16_t length; // routeUnreachable if some star or the exit cannot be reached
+  uint32_t nodes;  // Search nodes visited
+  bool exact;      // false if the search ran out of budget or is not over yet
+  uint32_t lookups; // Distances read, counted by host builds only (see route_bench)
+};
+
+// Exact depth-first branch and bound, for the board: O(stars) memory. It
+// tries the nearest star first (so the first route it finds is the greedy
+// one) and drops every branch whose length plus the way through its worst
+// remaining star to the exit, or the minimum spanning tree of the rest,
+// cannot beat the best route so far. Stops after `budget` nodes with the
+// best route found until then.
+//
+// The search keeps its own stack, so it can be run a few nodes at a time
+// (run()) and always ends the same way however it is sliced. dist must
+// stay put until it is done.
+class RouteSearch {
+public:
+  void begin(const uint16_t *dist, uint8_t stars, uint32_t budget);
+  // Visits up to `nodes` more nodes; true once the search is over
+  bool run(uint32_t nodes);
+  bool done() const { return depth == 0; }
+  RouteResult result() const;
+
+private:
+  struct Frame {
+    uint8_t at;
+    uint16_t left;   // Star bit s is route point s + 1
+    uint16_t length;
+    uint16_t tried;  // Of left, the stars already branched into
+  };
+
+  uint16_t lookup(uint8_t i, uint8_t j);
+  uint16_t treeBound(uint8_t at, uint16_t left);
+  void visit(uint8_t at, uint16_t left, uint16_t length);
+
+  const uint16_t *dist;
+  uint8_t exit;
+  uint16_t best;
+  uint32_t nodes;
+  uint32_t budget;
+  bool cut; // Ran out of budget
+  uint8_t depth;
+  Frame frames[routeMaxStars + 1];
+#if !defined(__AVR__)
+  uint32_t lookups;
+#endif
+};
+
+// All of a search in one call
+RouteResult routeSearch(const uint16_t *dist, uint8_t stars, uint32_t budget);
+
+// Held-Karp over star subsets: exact in O(2^k k^2) time whatever the
+// layout, but needs a table of (1 << stars) * stars words, which for ten
+// stars is ten times the Uno's RAM. For host tools.
+uint16_t routeHeldKarp(const uint16_t *dist, uint8_t stars, uint16_t *table);
+
+#endif
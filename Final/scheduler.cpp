@@ -0,0 +1,75 @@
+#include "scheduler.h"
+
+// Wrap-safe "a is at or after b" for millis() timestamps
+static bool reached(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) >= 0;
+}
+
+TaskScheduler::TaskScheduler(Task *table, uint8_t count) : tasks(table), taskCount(count) {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    tasks[i].nextDue = 0;
+    tasks[i].armed = tasks[i].periodMs > 0;
+  }
+  resetStats();
+}
+
+uint32_t TaskScheduler::runDue(uint32_t now) {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    Task &t = tasks[i];
+    if (!t.armed || !reached(now, t.nextDue)) continue;
+
+    if (t.periodMs == 0) {
+      t.armed = false;
+    } else {
+      if (reached(now, t.nextDue + t.periodMs)) {
+        // Missed whole periods: keep up to maxCatchUp of them due, to run
+        // on the following passes, and skip the rest
+        t.overruns++;
+        uint32_t late = (now - t.nextDue) / t.periodMs;
+        if (late > t.maxCatchUp) {
+          uint32_t skip = late - t.maxCatchUp;
+          t.dropped = t.dropped + skip > 0xFFFF ? 0xFFFF : t.dropped + skip;
+          t.nextDue += skip * t.periodMs;
+        }
+      }
+      t.nextDue += t.periodMs;
+    }
+
+    uint32_t start = micros();
+    t.run();
+    uint32_t spent = micros() - start;
+    t.runs++;
+    if (spent > t.maxRunMicros) t.maxRunMicros = spent > 0xFFFF ? 0xFFFF : spent;
+  }
+
+  // Tasks may have re-armed each other while running
+  uint32_t nextWake = now + maxIdleMs;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (tasks[i].armed && !reached(tasks[i].nextDue, nextWake)) nextWake = tasks[i].nextDue;
+  }
+  return nextWake;
+}
+
+void TaskScheduler::wake(uint8_t id, uint32_t at) {
+  tasks[id].nextDue = at;
+  tasks[id].armed = true;
+}
+
+void TaskScheduler::resetStats() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    tasks[i].runs = 0;
+    tasks[i].overruns = 0;
+    tasks[i].dropped = 0;
+    tasks[i].maxRunMicros = 0;
+  }
+}
+
+void RateMeter::mark(uint32_t now) {
+  count++;
+  uint32_t elapsed = now - windowStart;
+  if (elapsed < 1000) return;
+  // Closed late by up to one event period, so scale to the window's length
+  perSecond = (uint32_t)count * 1000 / elapsed;
+  count = 0;
+  windowStart = now;
+}
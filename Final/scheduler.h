@@ -0,0 +1,62 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+typedef void (*TaskFunction)();
+
+// One row of the static task table. Periodic tasks are re-armed period ms
+// after their previous due time; a period of 0 makes a deadline task that
+// runs once per wake() call.
+//
+// A periodic task that falls whole periods behind runs again on the next
+// passes for up to maxCatchUp of them, so a fixed-step task keeps its step
+// count through a stall; the periods past that are dropped.
+struct Task {
+  TaskFunction run;
+  uint16_t periodMs;
+  uint8_t maxCatchUp;
+  uint32_t nextDue;
+  bool armed;
+  uint32_t runs;
+  uint16_t overruns;     // runs that started a whole period or more late
+  uint16_t dropped;      // periods skipped instead of caught up
+  uint16_t maxRunMicros;
+};
+
+// Counts events (game ticks, frames) and keeps how many came in the last
+// whole window of about a second
+struct RateMeter {
+  uint16_t perSecond;
+  uint16_t count;
+  uint32_t windowStart;
+
+  void mark(uint32_t now);
+};
+
+// Cooperative scheduler over a fixed table: runs only the tasks that are
+// due, in table order, and reports when the next one will be.
+class TaskScheduler {
+public:
+  // Periodic tasks start armed and due immediately
+  TaskScheduler(Task *table, uint8_t count);
+
+  // Runs every task due at `now` and returns the earliest time a task is
+  // due next (at most maxIdleMs ahead when nothing is armed)
+  uint32_t runDue(uint32_t now);
+
+  // (Re)arms task `id` to run at `at`
+  void wake(uint8_t id, uint32_t at);
+
+  uint8_t count() const { return taskCount; }
+  const Task &task(uint8_t id) const { return tasks[id]; }
+  void resetStats();
+
+  static const uint16_t maxIdleMs = 1000;
+
+private:
+  Task *tasks;
+  uint8_t taskCount;
+};
+
+#endif
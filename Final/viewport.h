@@ -0,0 +1,91 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+// Level rows are bit-packed words with column 0 in the MSB. These helpers
+// work on whole rows so a frame costs one shift-and-mask per matrix row no
+// matter how wide the row type is.
+
+template <typename RowT>
+inline RowT levelColumnMask(uint8_t col) {
+  return (RowT)((RowT)1 << (sizeof(RowT) * 8 - 1 - col));
+}
+
+// Mask of the first `width` columns of a row
+template <typename RowT>
+inline RowT levelWidthMask(uint8_t width) {
+  const uint8_t bits = sizeof(RowT) * 8;
+  if (width >= bits) return (RowT)~(RowT)0;
+  return (RowT)~((RowT)~(RowT)0 >> width);
+}
+
+// The 8 columns starting at colOffset, bit 7 being colOffset. Columns at or
+// past `width` read as empty.
+template <typename RowT>
+inline uint8_t viewportRowBits(RowT row, uint8_t colOffset, uint8_t width) {
+  const uint8_t bits = sizeof(RowT) * 8;
+  row &= levelWidthMask<RowT>(width);
+  return (uint8_t)((RowT)(row << colOffset) >> (bits - 8));
+}
+
+inline uint8_t readProgmemRow(const uint8_t *row) { return pgm_read_byte(row); }
+inline uint16_t readProgmemRow(const uint16_t *row) { return pgm_read_word(row); }
+inline uint32_t readProgmemRow(const uint32_t *row) { return pgm_read_dword(row); }
+inline uint64_t readProgmemRow(const uint64_t *row) {
+  // Little-endian: low dword first
+  const uint32_t *halves = (const uint32_t *)row;
+  return ((uint64_t)pgm_read_dword(halves + 1) << 32) | pgm_read_dword(halves);
+}
+
+// Where level rows come from. Each source turns the level's data pointer
+// into row r (or a single cell) of a level `width` columns wide; the
+// geometry templates take one as a parameter so the lookup inlines.
+
+// Plain row arrays in flash
+struct ProgmemRows {
+  template <typename RowT>
+  static RowT read(const void *level, uint8_t, uint8_t r) {
+    return readProgmemRow((const RowT *)level + r);
+  }
+  template <typename RowT>
+  static bool cell(const void *level, uint8_t width, uint8_t c, uint8_t r) {
+    return read<RowT>(level, width, r) & levelColumnMask<RowT>(c);
+  }
+};
+
+// Rows generated at runtime
+struct RamRows {
+  template <typename RowT>
+  static RowT read(const void *level, uint8_t, uint8_t r) {
+    return ((const RowT *)level)[r];
+  }
+  template <typename RowT>
+  static bool cell(const void *level, uint8_t, uint8_t c, uint8_t r) {
+    return ((const RowT *)level)[r] & levelColumnMask<RowT>(c);
+  }
+};
+
+// Fills out with the PanelWidth x PanelHeight window at (colOffset,
+// rowOffset) of a level, OR-ing in overlay[r] (level-row masks for entities,
+// indexed by viewport row) before extraction. Each output row is
+// PanelWidth / 8 bytes, leftmost first. A null level extracts the overlay
+// alone.
+template <typename RowT, typename Source = ProgmemRows, uint8_t PanelWidth = 8, uint8_t PanelHeight = 8>
+void extractViewport(const void *level, uint8_t width, uint8_t height,
+                     uint8_t colOffset, uint8_t rowOffset,
+                     const RowT *overlay, uint8_t *out) {
+  const uint8_t bits = sizeof(RowT) * 8;
+  for (uint8_t r = 0; r < PanelHeight; r++) {
+    uint8_t levelR = r + rowOffset;
+    RowT row = overlay[r];
+    if (level && levelR < height) row |= Source::template read<RowT>(level, width, levelR);
+    for (uint8_t b = 0; b < PanelWidth / 8; b++) {
+      uint8_t col = colOffset + b * 8;
+      *out++ = col < bits ? viewportRowBits<RowT>(row, col, width) : 0;
+    }
+  }
+}
+
+#endif